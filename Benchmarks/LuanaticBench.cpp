@@ -0,0 +1,501 @@
+#include <Luanatic/Luanatic.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace stick;
+
+// stick allocator that forwards to the default allocator and counts
+// every allocation that luanatic does through it (wrapped objects, state)
+class CountingAllocator : public Allocator
+{
+public:
+
+    CountingAllocator() :
+        m_allocationCount(0)
+    {
+
+    }
+
+    Block allocate(Size _byteCount, Size _alignment)
+    {
+        ++m_allocationCount;
+        return defaultAllocator().allocate(_byteCount, _alignment);
+    }
+
+    Block reallocate(const Block & _blk, Size _byteCount, Size _alignment)
+    {
+        ++m_allocationCount;
+        return defaultAllocator().reallocate(_blk, _byteCount, _alignment);
+    }
+
+    void deallocate(const Block & _block)
+    {
+        defaultAllocator().deallocate(_block);
+    }
+
+    Size m_allocationCount;
+};
+
+// lua_Alloc that counts every (re)allocation done by the lua state itself
+static void * countingLuaAlloc(void * _userData, void * _ptr, size_t _oldSize, size_t _newSize)
+{
+    if (_newSize == 0)
+    {
+        std::free(_ptr);
+        return nullptr;
+    }
+    ++*static_cast<Size *>(_userData);
+    return std::realloc(_ptr, _newSize);
+}
+
+struct BenchState
+{
+    // if _bPooledLuaAlloc is true, lua allocates through allocator and the size class pools of luanatic
+    BenchState(bool _bPooledLuaAlloc = false) :
+        luaAllocationCount(0)
+    {
+        if (_bPooledLuaAlloc)
+        {
+            state = luanatic::createLuaState(allocator);
+        }
+        else
+        {
+            state = luanatic::createLuaState(countingLuaAlloc, &luaAllocationCount);
+        }
+        luanatic::openStandardLibraries(state);
+        luanatic::initialize(state, allocator);
+    }
+
+    Size luaAllocations() const
+    {
+        auto stats = luanatic::luaAllocatorStatistics(state);
+        return stats ? (*stats).allocationCount : luaAllocationCount;
+    }
+
+    ~BenchState()
+    {
+        lua_close(state);
+    }
+
+    CountingAllocator allocator;
+    Size luaAllocationCount;
+    lua_State * state;
+};
+
+// measures one benchmark run and prints ns/op and allocations/op
+class Measurement
+{
+public:
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    Measurement(BenchState & _bs, const char * _name, Size _iterations) :
+        m_bs(_bs),
+        m_name(_name),
+        m_iterations(_iterations),
+        m_luaAllocationStart(_bs.luaAllocations()),
+        m_allocationStart(_bs.allocator.m_allocationCount),
+        m_start(Clock::now())
+    {
+
+    }
+
+    ~Measurement()
+    {
+        Clock::time_point end = Clock::now();
+        Float64 ns = std::chrono::duration<Float64, std::nano>(end - m_start).count();
+        Float64 its = static_cast<Float64>(m_iterations);
+        std::printf("%-36s %10llu %12.2f %14.3f %14.3f\n",
+                    m_name,
+                    static_cast<unsigned long long>(m_iterations),
+                    ns / its,
+                    (m_bs.luaAllocations() - m_luaAllocationStart) / its,
+                    (m_bs.allocator.m_allocationCount - m_allocationStart) / its);
+    }
+
+private:
+
+    BenchState & m_bs;
+    const char * m_name;
+    Size m_iterations;
+    Size m_luaAllocationStart;
+    Size m_allocationStart;
+    Clock::time_point m_start;
+};
+
+// compiles "return function(n) <setup> for i = 1, n do <body> end end" and times it
+static void luaLoop(BenchState & _bs, const char * _name, const char * _setup, const char * _body, Size _iterations)
+{
+    char code[1024];
+    std::snprintf(code, sizeof(code), "return function(n) %s for i = 1, n do %s end end", _setup, _body);
+    if (luaL_loadstring(_bs.state, code) || lua_pcall(_bs.state, 0, 1, 0))
+    {
+        std::printf("%s: %s\n", _name, lua_tostring(_bs.state, -1));
+        lua_pop(_bs.state, 1);
+        return;
+    }
+
+    //warm up
+    lua_pushvalue(_bs.state, -1);
+    lua_pushinteger(_bs.state, _iterations / 10 + 1);
+    if (lua_pcall(_bs.state, 1, 0, 0))
+    {
+        std::printf("%s: %s\n", _name, lua_tostring(_bs.state, -1));
+        lua_pop(_bs.state, 2);
+        return;
+    }
+
+    lua_gc(_bs.state, LUA_GCCOLLECT, 0);
+    {
+        Measurement m(_bs, _name, _iterations);
+        lua_pushinteger(_bs.state, _iterations);
+        lua_call(_bs.state, 1, 0);
+    }
+}
+
+struct Vec2
+{
+    Vec2() :
+        x(0),
+        y(0)
+    {
+
+    }
+
+    Vec2(Float32 _x, Float32 _y) :
+        x(_x),
+        y(_y)
+    {
+
+    }
+
+    Float32 dot(const Vec2 & _other) const
+    {
+        return x * _other.x + y * _other.y;
+    }
+
+    Vec2 scaled(Float32 _s) const
+    {
+        return Vec2(x * _s, y * _s);
+    }
+
+    Vec2 scaled(const Vec2 & _s) const
+    {
+        return Vec2(x * _s.x, y * _s.y);
+    }
+
+    Float32 x;
+    Float32 y;
+};
+
+// same as Vec2, registered with inline storage
+struct InlineVec2 : public Vec2
+{
+    InlineVec2(Float32 _x, Float32 _y) :
+        Vec2(_x, _y)
+    {
+
+    }
+
+    Float32 sum() const
+    {
+        return x + y;
+    }
+};
+
+// deep single inheritance chain to measure casting to far away bases
+template<Int32 N>
+struct Level : public Level < N - 1 >
+{
+};
+
+template<>
+struct Level<0>
+{
+    virtual ~Level() {}
+
+    Int32 value = 1;
+};
+
+template<Int32 N>
+struct LevelRegistration
+{
+    static void registerLevel(luanatic::LuaValue & _namespace)
+    {
+        LevelRegistration < N - 1 >::registerLevel(_namespace);
+        char name[32];
+        std::snprintf(name, sizeof(name), "Level%i", N);
+        luanatic::ClassWrapper<Level<N>> cw(name);
+        cw.template addBase<Level < N - 1 >> ();
+        cw.setCacheBorrowed(true);
+        cw.addConstructor();
+        _namespace.registerClass(cw);
+    }
+};
+
+template<>
+struct LevelRegistration<0>
+{
+    static void registerLevel(luanatic::LuaValue & _namespace)
+    {
+        luanatic::ClassWrapper<Level<0>> cw("Level0");
+        cw.addConstructor();
+        _namespace.registerClass(cw);
+    }
+};
+
+static Float32 add(Float32 _a, Float32 _b)
+{
+    return _a + _b;
+}
+
+static Int32 overloaded(Int32 _a, Int32 _b)
+{
+    return _a + _b;
+}
+
+static Float32 overloaded(Float32 _a)
+{
+    return _a;
+}
+
+static const char * overloaded(const char * _str)
+{
+    return _str;
+}
+
+// same as Vec2, registered with pooled storage
+struct PooledVec2 : public Vec2
+{
+    PooledVec2(Float32 _x, Float32 _y) :
+        Vec2(_x, _y)
+    {
+
+    }
+};
+
+static Vec2 makeVec2(Float32 _x, Float32 _y)
+{
+    return Vec2(_x, _y);
+}
+
+static InlineVec2 makeInlineVec2(Float32 _x, Float32 _y)
+{
+    return InlineVec2(_x, _y);
+}
+
+static PooledVec2 makePooledVec2(Float32 _x, Float32 _y)
+{
+    return PooledVec2(_x, _y);
+}
+
+static Float32 firstOfArray(DynamicArray<Float32> _array)
+{
+    return _array[0];
+}
+
+static Float32 firstOfView(luanatic::TableView<Float32> _view)
+{
+    return _view[0];
+}
+
+static Size stringLength(const String & _str)
+{
+    return _str.length();
+}
+
+static Size stringViewLength(luanatic::StringView _str)
+{
+    return _str.length();
+}
+
+static Int32 levelValue(const Level<0> & _level)
+{
+    return _level.value;
+}
+
+int main(int _argc, const char * _args[])
+{
+    // optional scale factor for the iteration counts
+    Size scale = _argc > 1 ? std::strtoul(_args[1], nullptr, 10) : 1;
+    if (scale == 0) scale = 1;
+    const Size callIterations = 1000000 * scale;
+    const Size arrayIterations = 10000 * scale;
+
+    std::printf("%-36s %10s %12s %14s %14s\n", "benchmark", "iterations", "ns/op", "lua allocs/op", "obj allocs/op");
+
+    BenchState bs;
+    lua_State * state = bs.state;
+    {
+        luanatic::LuaValue globals = luanatic::globalsTable(state);
+
+        luanatic::ClassWrapper<Vec2> vw("Vec2");
+        vw.
+        addConstructor<>().
+        addConstructor<Float32, Float32>().
+        addMemberFunction("dot", LUANATIC_FUNCTION(&Vec2::dot)).
+        addMemberFunction("scaled", LUANATIC_FUNCTION_OVERLOAD(Vec2(Vec2::*)(Float32) const, &Vec2::scaled)).
+        addMemberFunction("scaled", LUANATIC_FUNCTION_OVERLOAD(Vec2(Vec2::*)(const Vec2 &) const, &Vec2::scaled)).
+        addAttribute("x", LUANATIC_ATTRIBUTE(&Vec2::x)).
+        addAttribute("y", LUANATIC_ATTRIBUTE(&Vec2::y));
+        globals.registerClass(vw);
+
+        luanatic::ClassWrapper<InlineVec2> ivw("InlineVec2");
+        ivw.
+        setStorageMode(luanatic::StorageMode::Inline).
+        addConstructor<Float32, Float32>().
+        addMemberFunction("sum", LUANATIC_FUNCTION(&InlineVec2::sum));
+        globals.registerClass(ivw);
+
+        luanatic::ClassWrapper<PooledVec2> pvw("PooledVec2");
+        pvw.
+        setStorageMode(luanatic::StorageMode::Pooled).
+        addConstructor<Float32, Float32>();
+        globals.registerClass(pvw);
+
+        LevelRegistration<6>::registerLevel(globals);
+
+        globals.
+        registerFunction("add", LUANATIC_FUNCTION(&add)).
+        registerFunction("overloaded", LUANATIC_FUNCTION_OVERLOAD(Int32(*)(Int32, Int32), &overloaded)).
+        registerFunction("overloaded", LUANATIC_FUNCTION_OVERLOAD(Float32(*)(Float32), &overloaded)).
+        registerFunction("overloaded", LUANATIC_FUNCTION_OVERLOAD(const char * (*)(const char *), &overloaded)).
+        registerFunction("makeVec2", LUANATIC_FUNCTION(&makeVec2)).
+        registerFunction("makeInlineVec2", LUANATIC_FUNCTION(&makeInlineVec2)).
+        registerFunction("makePooledVec2", LUANATIC_FUNCTION(&makePooledVec2)).
+        registerFunction("levelValue", LUANATIC_FUNCTION(&levelValue)).
+        registerFunction("firstOfArray", LUANATIC_FUNCTION(&firstOfArray)).
+        registerFunction("firstOfView", LUANATIC_FUNCTION(&firstOfView)).
+        registerFunction("stringLength", LUANATIC_FUNCTION(&stringLength)).
+        registerFunction("stringViewLength", LUANATIC_FUNCTION(&stringViewLength));
+
+        luaLoop(bs, "free function call", "local add = add", "add(1.5, 2.5)", callIterations);
+        luaLoop(bs, "member function call", "local v = Vec2(1, 2) local w = Vec2(3, 4)", "v:dot(w)", callIterations);
+        luaLoop(bs, "member call (no attributes)", "local v = InlineVec2(1, 2)", "v:sum()", callIterations);
+        luaLoop(bs, "overloaded dispatch (int, int)", "local f = overloaded", "f(1, 2)", callIterations);
+        luaLoop(bs, "overloaded dispatch (string)", "local f = overloaded", "f('a')", callIterations);
+        luaLoop(bs, "overloaded member dispatch", "local v = Vec2(1, 2) local w = Vec2(3, 4)", "v:scaled(w)", callIterations);
+        luaLoop(bs, "constructor call", "", "Vec2(1, 2)", callIterations);
+        luaLoop(bs, "constructor call (inline storage)", "", "InlineVec2(1, 2)", callIterations);
+        luaLoop(bs, "constructor call (pooled storage)", "", "PooledVec2(1, 2)", callIterations);
+        luaLoop(bs, "return by value", "local f = makeVec2", "f(1, 2)", callIterations);
+        luaLoop(bs, "return by value (inline storage)", "local f = makeInlineVec2", "f(1, 2)", callIterations);
+        luaLoop(bs, "return by value (pooled storage)", "local f = makePooledVec2", "f(1, 2)", callIterations);
+        luaLoop(bs, "attribute get", "local v = Vec2(1, 2) local x", "x = v.x", callIterations);
+        luaLoop(bs, "attribute set", "local v = Vec2(1, 2)", "v.x = i", callIterations);
+        luaLoop(bs, "member function lookup", "local v = Vec2(1, 2) local f", "f = v.dot", callIterations);
+        luaLoop(bs, "deep cast argument (6 levels)", "local l = Level6()", "levelValue(l)", callIterations);
+
+        {
+            Vec2 * owned = nullptr;
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            Measurement m(bs, "pushWrapped lua owned", callIterations);
+            for (Size i = 0; i < callIterations; ++i)
+            {
+                owned = bs.allocator.create<Vec2>(1.0f, 2.0f);
+                luanatic::pushWrapped<Vec2>(state, owned, true);
+                lua_pop(state, 1);
+            }
+        }
+
+        {
+            Vec2 borrowed(1.0f, 2.0f);
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            Measurement m(bs, "pushWrapped borrowed", callIterations);
+            for (Size i = 0; i < callIterations; ++i)
+            {
+                luanatic::pushWrapped<Vec2>(state, &borrowed, false);
+                lua_pop(state, 1);
+            }
+        }
+
+        {
+            Level<6> deep;
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            Measurement m(bs, "pushWrapped borrowed (cached)", callIterations);
+            for (Size i = 0; i < callIterations; ++i)
+            {
+                luanatic::pushWrapped<Level<6>>(state, &deep, false);
+                lua_pop(state, 1);
+            }
+        }
+
+        {
+            Level<6> deep;
+            luanatic::pushWrapped<Level<6>>(state, &deep, false);
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            Int32 sum = 0;
+            {
+                Measurement m(bs, "convertToType deep cast", callIterations);
+                for (Size i = 0; i < callIterations; ++i)
+                    sum += luanatic::convertToType<Level<0>>(state, -1)->value;
+            }
+            lua_pop(state, 1);
+            if (sum != static_cast<Int32>(callIterations))
+                std::printf("deep cast returned unexpected result\n");
+        }
+
+        {
+            DynamicArray<Float32> numbers;
+            numbers.resize(1000);
+            for (Size i = 0; i < numbers.count(); ++i)
+                numbers[i] = static_cast<Float32>(i);
+
+            Float32 sum = 0;
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            {
+                Measurement m(bs, "DynamicArray<Float32> 1000 round trip", arrayIterations);
+                for (Size i = 0; i < arrayIterations; ++i)
+                {
+                    luanatic::pushValueType(state, numbers);
+                    sum += luanatic::convertToValueTypeAndCheck<DynamicArray<Float32>>(state, lua_gettop(state))[999];
+                    lua_pop(state, 1);
+                }
+            }
+            if (sum != 999.0f * arrayIterations)
+                std::printf("array round trip returned unexpected result\n");
+        }
+
+        {
+            luanatic::execute(state, "function luaAdd(a, b) return a + b end");
+            Float32 sum = 0;
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            {
+                Measurement m(bs, "LuaValue::callFunction", callIterations);
+                for (Size i = 0; i < callIterations; ++i)
+                    sum += globals.callFunction<Float32>("luaAdd", 1.0f, 2.0f);
+            }
+            if (sum <= 0)
+                std::printf("callFunction returned unexpected result\n");
+        }
+
+        {
+            DynamicArray<Float32> numbers;
+            numbers.resize(1000);
+            luanatic::pushBuffer(state, numbers.ptr(), numbers.count());
+            lua_setglobal(state, "benchBuffer");
+            luaLoop(bs, "buffer element read and write", "local b = benchBuffer", "b[500] = b[500] + 1", callIterations);
+            luaLoop(bs, "buffer scale 1000 (lua loop)", "local b = benchBuffer", "for j = 1, 1000 do b[j] = b[j] * 0.5 end", arrayIterations);
+            luaLoop(bs, "buffer scale 1000 (luanatic.simd)", "local b = benchBuffer local scale = luanatic.simd.scale", "scale(b, b, 0.5)", arrayIterations);
+            lua_pushnil(state);
+            lua_setglobal(state, "benchBuffer");
+        }
+
+        luaLoop(bs, "first of 1000 (DynamicArray arg)", "local t = {} for j = 1, 1000 do t[j] = j end local f = firstOfArray", "f(t)", arrayIterations);
+        luaLoop(bs, "first of 1000 (TableView arg)", "local t = {} for j = 1, 1000 do t[j] = j end local f = firstOfView", "f(t)", arrayIterations);
+
+        luaLoop(bs, "string argument (String)", "local f = stringLength local s = 'a fairly long identifier string'", "f(s)", callIterations);
+        luaLoop(bs, "string argument (StringView)", "local f = stringViewLength local s = 'a fairly long identifier string'", "f(s)", callIterations);
+
+        luaLoop(bs, "table and string churn", "local t", "t = {i, tostring(i)}", callIterations);
+    }
+
+    {
+        BenchState pooled(true);
+        luaLoop(pooled, "table and string churn (pooled)", "local t", "t = {i, tostring(i)}", callIterations);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -15,11 +15,16 @@
 #include <Stick/Variant.hpp>
 #include <Stick/Private/IndexSequence.hpp>
 
+#include <algorithm>
 #include <type_traits>
 #include <functional> //for std::ref
+#include <atomic>
 #include <tuple>
 #include <cstdint>
+#include <cstdlib>
+#include <cstdio>
 #include <cstring>
+#include <limits>
 
 #ifdef __GNUC__
 #include <cxxabi.h>
@@ -32,17 +37,40 @@ extern "C" {
 }
 
 #define LUANATIC_KEY "__Luanatic"
+
+//on lua 5.3+ the LuanaticState pointer is cached in the extra space of lua_States created
+//with createLuaState so it can be retrieved without any registry lookups. Define
+//LUANATIC_NO_EXTRASPACE if your application uses the extra space for something else.
+#if LUA_VERSION_NUM >= 503 && !defined(LUANATIC_NO_EXTRASPACE)
+#define LUANATIC_USE_EXTRASPACE
+#endif
+
+//the luanatic.simd buffer kernels use AVX or SSE2 intrinsics for Float32 and Float64
+//if the compiler targets them. Define LUANATIC_NO_SIMD to always use the scalar kernels.
+#if !defined(LUANATIC_NO_SIMD)
+#if defined(__AVX__)
+#define LUANATIC_USE_AVX
+#elif defined(__SSE2__)
+#define LUANATIC_USE_SSE
+#endif
+#endif
+
+#if defined(LUANATIC_USE_AVX) || defined(LUANATIC_USE_SSE)
+#include <immintrin.h>
+#endif
 #define LUANATIC_FUNCTION_1(x){\
  &luanatic::detail::FunctionWrapper<decltype(x), x>::func,\
  &luanatic::detail::FunctionWrapper<decltype(x), x>::score,\
  &luanatic::detail::FunctionWrapper<decltype(x), x>::signatureStr,\
- &luanatic::detail::FunctionWrapper<decltype(x), x>::argCount\
+ &luanatic::detail::FunctionWrapper<decltype(x), x>::argCount,\
+ luanatic::detail::FunctionWrapper<decltype(x), x>::bShapeOnlyScore\
 }
 #define LUANATIC_FUNCTION_P(x, ...){\
 &luanatic::detail::FunctionWrapper<decltype(x), x, __VA_ARGS__>::func,\
 &luanatic::detail::FunctionWrapper<decltype(x), x, __VA_ARGS__>::score,\
 &luanatic::detail::FunctionWrapper<decltype(x), x, __VA_ARGS__>::signatureStr,\
-&luanatic::detail::FunctionWrapper<decltype(x), x, __VA_ARGS__>::argCount\
+&luanatic::detail::FunctionWrapper<decltype(x), x, __VA_ARGS__>::argCount,\
+luanatic::detail::FunctionWrapper<decltype(x), x, __VA_ARGS__>::bShapeOnlyScore\
 }
 #define LUANATIC_GET_MACRO(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,NAME,...) NAME
 #define LUANATIC_FUNCTION(...) LUANATIC_GET_MACRO(__VA_ARGS__, \
@@ -60,13 +88,15 @@ LUANATIC_FUNCTION_1)(__VA_ARGS__)
  &luanatic::detail::FunctionWrapper<sig, x>::func,\
  &luanatic::detail::FunctionWrapper<sig, x>::score,\
  &luanatic::detail::FunctionWrapper<sig, x>::signatureStr,\
- &luanatic::detail::FunctionWrapper<sig, x>::argCount\
+ &luanatic::detail::FunctionWrapper<sig, x>::argCount,\
+ luanatic::detail::FunctionWrapper<sig, x>::bShapeOnlyScore\
 }
 #define LUANATIC_FUNCTION_OVERLOAD_P(sig, x, ...) {\
 &luanatic::detail::FunctionWrapper<sig, x, __VA_ARGS__>::func,\
 &luanatic::detail::FunctionWrapper<sig, x, __VA_ARGS__>::score,\
 &luanatic::detail::FunctionWrapper<sig, x, __VA_ARGS__>::signatureStr,\
-&luanatic::detail::FunctionWrapper<sig, x, __VA_ARGS__>::argCount\
+&luanatic::detail::FunctionWrapper<sig, x, __VA_ARGS__>::argCount,\
+luanatic::detail::FunctionWrapper<sig, x, __VA_ARGS__>::bShapeOnlyScore\
 }
 #define LUANATIC_FUNCTION_OVERLOAD(...) LUANATIC_GET_MACRO(__VA_ARGS__, \
 LUANATIC_FUNCTION_OVERLOAD_P, \
@@ -87,6 +117,19 @@ namespace luanatic
 
     inline lua_State * createLuaState();
 
+    //creates a lua_State that does all of its own allocations through _allocator.
+    //Small blocks are served from size class pools, see LuaAllocatorStatistics.
+    inline lua_State * createLuaState(stick::Allocator & _allocator);
+
+    //creates a lua_State that allocates through _allocFunction, use this instead of lua_newstate
+    //if the state should use a custom lua_Alloc and still get the fast LuanaticState lookup.
+    inline lua_State * createLuaState(lua_Alloc _allocFunction, void * _userData);
+
+    struct LuaAllocatorStatistics;
+
+    //memory statistics of a lua_State created with createLuaState(stick::Allocator &), nothing otherwise
+    inline stick::Maybe<LuaAllocatorStatistics> luaAllocatorStatistics(lua_State * _state);
+
     inline void initialize(lua_State * _state, stick::Allocator & _allocator = stick::defaultAllocator());
 
     inline void openStandardLibraries(lua_State * _state);
@@ -99,6 +142,21 @@ namespace luanatic
 
     inline void addPackagePath(lua_State * _state, const stick::String & _path);
 
+    //pushes a buffer userdata that gives lua indexed access to _count elements at _data without
+    //copying them. The memory has to stay valid for as long as lua uses the buffer.
+    template<class T>
+    inline void pushBuffer(lua_State * _state, T * _data, stick::Size _count);
+
+    //same as above for read only buffers
+    template<class T>
+    inline void pushBuffer(lua_State * _state, const T * _data, stick::Size _count);
+
+    template<class G>
+    struct ReturnBuffer;
+
+    template<class T>
+    class TableView;
+
     template <class T>
     inline bool isOfType(lua_State * _luaState, stick::Int32 _index, bool _bStrict = false);
 
@@ -147,6 +205,62 @@ namespace luanatic
         Table
     };
 
+    //how lua owned instances of a registered class are stored
+    enum class STICK_API StorageMode
+    {
+        //the object is created with the stick::Allocator of the state and the userdata holds a pointer to it
+        Allocator,
+        //the object is constructed right behind the UserData header inside the userdata block
+        //and destroyed in place by __gc
+        Inline,
+        //the object is created in a fixed size slot of a per class pool (see ClassWrapper::setPoolSlabSize)
+        //and the slot is recycled by __gc, saving the allocator round trip for classes with a lot of churn
+        Pooled
+    };
+
+    //memory used by lua itself (tables, strings, closures, userdata...) in a state created
+    //with createLuaState(stick::Allocator &)
+    struct STICK_API LuaAllocatorStatistics
+    {
+        //bytes currently allocated
+        stick::Size byteCount;
+        //blocks currently allocated
+        stick::Size blockCount;
+        //number of allocations and reallocations since the state was created
+        stick::Size allocationCount;
+        //number of those that were served by the size class pools
+        stick::Size pooledAllocationCount;
+    };
+
+    //element types of buffers, see pushBuffer
+    enum class STICK_API BufferElementType
+    {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Int64,
+        UInt64,
+        Float32,
+        Float64
+    };
+
+    template<class T>
+    struct BufferElementTypeOf;
+
+    template<> struct BufferElementTypeOf<stick::Int8> { static constexpr BufferElementType value = BufferElementType::Int8; };
+    template<> struct BufferElementTypeOf<stick::UInt8> { static constexpr BufferElementType value = BufferElementType::UInt8; };
+    template<> struct BufferElementTypeOf<stick::Int16> { static constexpr BufferElementType value = BufferElementType::Int16; };
+    template<> struct BufferElementTypeOf<stick::UInt16> { static constexpr BufferElementType value = BufferElementType::UInt16; };
+    template<> struct BufferElementTypeOf<stick::Int32> { static constexpr BufferElementType value = BufferElementType::Int32; };
+    template<> struct BufferElementTypeOf<stick::UInt32> { static constexpr BufferElementType value = BufferElementType::UInt32; };
+    template<> struct BufferElementTypeOf<stick::Int64> { static constexpr BufferElementType value = BufferElementType::Int64; };
+    template<> struct BufferElementTypeOf<stick::UInt64> { static constexpr BufferElementType value = BufferElementType::UInt64; };
+    template<> struct BufferElementTypeOf<stick::Float32> { static constexpr BufferElementType value = BufferElementType::Float32; };
+    template<> struct BufferElementTypeOf<stick::Float64> { static constexpr BufferElementType value = BufferElementType::Float64; };
+
     //lua operator names
     const char * EqualOperatorFlag = "__eq";
     const char * LessEqualOperatorFlag = "__le";
@@ -166,7 +280,12 @@ namespace luanatic
             stick::Int32 status;
 #ifdef __GNUC__
             auto ret = abi::__cxa_demangle(_name, NULL, NULL, &status);
-            return ret ? stick::String(ret) : _name;
+            if (!ret)
+                return _name;
+            //__cxa_demangle mallocs the result
+            stick::String str(ret);
+            std::free(ret);
+            return str;
 #else
             return _name;
 #endif
@@ -178,11 +297,53 @@ namespace luanatic
 
         typedef stick::String (*SignatureStrFunction) (void);
 
+        //returns the number of lua arguments a function expects (including self for member functions)
         typedef stick::Size (*ArgCountFunction) (void);
 
 
         inline stick::Size rawLen(lua_State * _state, int _index);
 
+        inline int absIndex(lua_State * _state, int _index);
+
+        //arithmetic types (but bool) are read and written by the array converters directly,
+        //without going through their ValueTypeConverter
+        template<class T>
+        struct IsArrayNumber : std::integral_constant < bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value > {};
+
+        //converts the number at _index to _out, returns false and leaves _out untouched if it's not
+        //a number (or not an integer for integral types on lua 5.3+)
+        template<class T>
+        inline bool toArrayNumber(lua_State * _state, int _index, T & _out)
+        {
+            int bIsNumber;
+            T value;
+#if LUA_VERSION_NUM >= 502
+            if (std::is_integral<T>::value)
+                value = static_cast<T>(lua_tointegerx(_state, _index, &bIsNumber));
+            else
+                value = static_cast<T>(lua_tonumberx(_state, _index, &bIsNumber));
+#else
+            bIsNumber = lua_isnumber(_state, _index);
+            if (std::is_integral<T>::value)
+                value = static_cast<T>(lua_tointeger(_state, _index));
+            else
+                value = static_cast<T>(lua_tonumber(_state, _index));
+#endif // LUA_VERSION_NUM >= 502
+            if (!bIsNumber)
+                return false;
+            _out = value;
+            return true;
+        }
+
+        template<class T>
+        inline void pushArrayNumber(lua_State * _state, T _value)
+        {
+            if (std::is_integral<T>::value)
+                lua_pushinteger(_state, static_cast<lua_Integer>(_value));
+            else
+                lua_pushnumber(_state, static_cast<lua_Number>(_value));
+        }
+
         inline lua_Debug debugInfo(lua_State * _state, int _level)
         {
             lua_Debug ar;
@@ -226,6 +387,9 @@ namespace luanatic
 
         template<class...Args>
         struct DefaultArgs;
+
+        template <class T, class ... Args>
+        inline void pushNew(lua_State * _luaState, Args && ... _args);
     }
 
     struct STICK_API LuanaticFunction
@@ -234,12 +398,14 @@ namespace luanatic
                          detail::ArgScoreFunction _b = nullptr,
                          detail::SignatureStrFunction _c = nullptr,
                          detail::ArgCountFunction _d = nullptr,
-                         detail::DefaultArgsBase * _e = nullptr) :
+                         bool _e = true,
+                         detail::DefaultArgsBase * _f = nullptr) :
             function(_a),
             scoreFunction(_b),
             signatureStrFunction(_c),
             argCountFunction(_d),
-            defaultArgs(_e)
+            bShapeOnlyScore(_e),
+            defaultArgs(_f)
         {
 
         }
@@ -248,6 +414,8 @@ namespace luanatic
         detail::ArgScoreFunction scoreFunction;
         detail::SignatureStrFunction signatureStrFunction;
         detail::ArgCountFunction argCountFunction;
+        //false if scoreFunction looks at more than the argument shapes, see detail::OverloadCache
+        bool bShapeOnlyScore;
         detail::DefaultArgsBase * defaultArgs;
     };
 
@@ -446,12 +614,93 @@ namespace luanatic
         static stick::String convertAndCheck(lua_State * _luaState,
                                              stick::Int32 _index)
         {
-            return stick::String(luaL_checkstring(_luaState, _index));
+            size_t len;
+            const char * str = luaL_checklstring(_luaState, _index, &len);
+            return stick::String(str, len);
         }
 
         static stick::Int32 push(lua_State * _luaState, const stick::String & _str)
         {
-            lua_pushstring(_luaState, _str.cString());
+            lua_pushlstring(_luaState, _str.cString(), _str.length());
+            return 1;
+        }
+    };
+
+    //non owning view of a string. As a function argument it points to the string lua passed,
+    //avoiding the allocation and copy of stick::String, and is only valid during that call.
+    class STICK_API StringView
+    {
+    public:
+
+        StringView() :
+            m_data(""),
+            m_length(0)
+        {
+
+        }
+
+        StringView(const char * _data, stick::Size _length) :
+            m_data(_data),
+            m_length(_length)
+        {
+
+        }
+
+        StringView(const char * _str) :
+            m_data(_str),
+            m_length(std::strlen(_str))
+        {
+
+        }
+
+        StringView(const stick::String & _str) :
+            m_data(_str.cString()),
+            m_length(_str.length())
+        {
+
+        }
+
+        //not zero terminated in general, only views of strings lua passed as arguments are
+        const char * data() const
+        {
+            return m_data;
+        }
+
+        stick::Size length() const
+        {
+            return m_length;
+        }
+
+        bool operator == (const StringView & _other) const
+        {
+            return m_length == _other.m_length && std::memcmp(m_data, _other.m_data, m_length) == 0;
+        }
+
+        bool operator != (const StringView & _other) const
+        {
+            return !(*this == _other);
+        }
+
+        stick::String toString() const
+        {
+            return stick::String(m_data, m_length);
+        }
+
+    private:
+
+        const char * m_data;
+        stick::Size m_length;
+    };
+
+    //StringView is only converted from function arguments (see Converter<StringView>), everywhere
+    //else the string it points to could be popped (i.e. a number converted to a string) right
+    //after the conversion. Pushing copies the string into lua, so that is fine anywhere.
+    template <>
+    struct ValueTypeConverter<StringView>
+    {
+        static stick::Int32 push(lua_State * _luaState, const StringView & _str)
+        {
+            lua_pushlstring(_luaState, _str.data(), _str.length());
             return 1;
         }
     };
@@ -481,18 +730,13 @@ namespace luanatic
 
             if (lua_istable(_luaState, _index))
             {
-                auto len = detail::rawLen(_luaState, _index);
-                if (len <= 0)
+                //only the sequence part is converted, in order
+                stick::Size len = detail::rawLen(_luaState, _index);
+                if (len == 0)
                 {
                     return ret;
                 }
-                ret.reserve(detail::rawLen(_luaState, _index));
-                for (lua_pushnil(_luaState);
-                        lua_next(_luaState, _index);
-                        lua_pop(_luaState, 1))
-                {
-                    ret.append(convertToValueTypeAndCheck<T>(_luaState, -1));
-                }
+                convertElements(_luaState, detail::absIndex(_luaState, _index), len, ret, detail::IsArrayNumber<T>());
             }
             else
             {
@@ -505,16 +749,57 @@ namespace luanatic
 
         static stick::Int32 push(lua_State * _luaState, const stick::DynamicArray<T> & _array)
         {
-            lua_newtable(_luaState);
-            auto it = _array.begin();
-            stick::Int32 i = 1;
-            for (; it != _array.end(); ++it, ++i)
+            lua_createtable(_luaState, static_cast<int>(_array.count()), 0);
+            pushElements(_luaState, _array, detail::IsArrayNumber<T>());
+            return 1;
+        }
+
+        static void convertElements(lua_State * _luaState, stick::Int32 _index, stick::Size _len,
+                                    stick::DynamicArray<T> & _out, std::true_type)
+        {
+            _out.resize(_len);
+            for (stick::Size i = 0; i < _len; ++i)
             {
-                lua_pushinteger(_luaState, i);
-                pushValueType<T>(_luaState, *it);
-                lua_settable(_luaState, -3);
+                lua_rawgeti(_luaState, _index, static_cast<lua_Integer>(i + 1));
+                bool bIsNumber = detail::toArrayNumber(_luaState, -1, _out[i]);
+                lua_pop(_luaState, 1);
+                if (!bIsNumber)
+                {
+                    //free the memory, the error jumps past the destructor
+                    _out = stick::DynamicArray<T>();
+                    luaL_error(_luaState, "Number expected at index %d of table", static_cast<int>(i + 1));
+                }
+            }
+        }
+
+        static void convertElements(lua_State * _luaState, stick::Int32 _index, stick::Size _len,
+                                    stick::DynamicArray<T> & _out, std::false_type)
+        {
+            _out.reserve(_len);
+            for (stick::Size i = 1; i <= _len; ++i)
+            {
+                lua_rawgeti(_luaState, _index, static_cast<lua_Integer>(i));
+                _out.append(convertToValueTypeAndCheck<T>(_luaState, -1));
+                lua_pop(_luaState, 1);
+            }
+        }
+
+        static void pushElements(lua_State * _luaState, const stick::DynamicArray<T> & _array, std::true_type)
+        {
+            for (stick::Size i = 0; i < _array.count(); ++i)
+            {
+                detail::pushArrayNumber(_luaState, _array[i]);
+                lua_rawseti(_luaState, -2, static_cast<lua_Integer>(i + 1));
+            }
+        }
+
+        static void pushElements(lua_State * _luaState, const stick::DynamicArray<T> & _array, std::false_type)
+        {
+            for (stick::Size i = 0; i < _array.count(); ++i)
+            {
+                pushValueType<T>(_luaState, _array[i]);
+                lua_rawseti(_luaState, -2, static_cast<lua_Integer>(i + 1));
             }
-            return 1;
         }
     };
 
@@ -694,6 +979,12 @@ namespace luanatic
             void * m_data;
             bool m_bOwnedByLua;
             stick::TypeID m_typeID;
+            //dense per state index of the class of m_typeID, 0 if unknown (i.e. for cast results)
+            stick::UInt32 m_classIndex;
+            //StorageMode::Inline if m_data lives inside of this userdata block, Pooled if it is a slot of the class pool
+            StorageMode m_storageMode;
+            //true once newIndex stored dynamic fields for this instance in its uservalue
+            bool m_bHasStorage;
         };
 
         struct STICK_LOCAL UserDataCastFunction
@@ -717,7 +1008,7 @@ namespace luanatic
         {
             static UserData cast(const UserData & _ud, detail::LuanaticState & _state)
             {
-                return {static_cast<To *>(static_cast<From *>(_ud.m_data)), _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID()};
+                return {static_cast<To *>(static_cast<From *>(_ud.m_data)), _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID(), 0, StorageMode::Allocator, false};
             }
         };
 
@@ -726,7 +1017,7 @@ namespace luanatic
         {
             static UserData cast(const UserData & _ud, detail::LuanaticState & _state)
             {
-                return {(To *)static_cast<stick::UniquePtr<From> *>(_ud.m_data)->get(), _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID()};
+                return {(To *)static_cast<stick::UniquePtr<From> *>(_ud.m_data)->get(), _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID(), 0, StorageMode::Allocator, false};
             }
         };
 
@@ -735,7 +1026,7 @@ namespace luanatic
         {
             static UserData cast(const UserData & _ud, detail::LuanaticState & _state)
             {
-                return {(To *)static_cast<stick::SharedPtr<From> *>(_ud.m_data)->get(), _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID()};
+                return {(To *)static_cast<stick::SharedPtr<From> *>(_ud.m_data)->get(), _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID(), 0, StorageMode::Allocator, false};
             }
         };
     }
@@ -761,6 +1052,9 @@ namespace luanatic
         ClassWrapperBase(stick::TypeID _typeID, const stick::String & _className)
             : m_typeID(_typeID)
             , m_className(_className)
+            , m_storageMode(StorageMode::Allocator)
+            , m_bCacheBorrowed(false)
+            , m_poolSlabSize(64)
         {
         }
 
@@ -772,6 +1066,9 @@ namespace luanatic
             , m_bases(_other.m_bases)
             , m_statics(_other.m_statics)
             , m_attributes(_other.m_attributes)
+            , m_storageMode(_other.m_storageMode)
+            , m_bCacheBorrowed(_other.m_bCacheBorrowed)
+            , m_poolSlabSize(_other.m_poolSlabSize)
         {
             // if (_other.m_storageWrapperTmp)
             //     m_storageWrapperTmp = _other.m_storageWrapperTmp->clone();
@@ -786,6 +1083,8 @@ namespace luanatic
             m_attributes = _other.m_attributes;
             m_bases = _other.m_bases;
             m_casts = _other.m_casts;
+            m_storageMode = _other.m_storageMode;
+            m_bCacheBorrowed = _other.m_bCacheBorrowed;
 
             // if (_other.m_storageWrapperTmp)
             //     m_storageWrapperTmp = _other.m_storageWrapperTmp->clone();
@@ -866,6 +1165,9 @@ namespace luanatic
         NamedLuaFunctionArray m_constructors;
         BaseArray m_bases;
         CastArray m_casts;
+        StorageMode m_storageMode;
+        bool m_bCacheBorrowed;
+        stick::Size m_poolSlabSize;
         //used if StorageT is not detail::RawPointerStorageFlag (see ClassWrapper) to describe the kind of storage and casts
         // ClassWrapperUniquePtr m_storageWrapperTmp; //this is only used before the class is registered to store the storage wrapper
     };
@@ -892,6 +1194,17 @@ namespace luanatic
         template <class CD>
         ClassWrapper & addCast();
 
+        //sets how instances constructed from lua are stored, see StorageMode
+        ClassWrapper & setStorageMode(StorageMode _mode);
+
+        //number of objects allocated at once by the pool of a StorageMode::Pooled class
+        ClassWrapper & setPoolSlabSize(stick::Size _objectCount);
+
+        //if true, pushing the same borrowed object repeatedly yields the same userdata.
+        //Only use this if objects of this class are not destroyed while lua still references them,
+        //as a new object at the same address would otherwise get the userdata of the old one.
+        ClassWrapper & setCacheBorrowed(bool _bCache);
+
         // ClassWrapperUniquePtr clone() const final
         // {
         //     //we just use default allocator here for now...
@@ -901,2086 +1214,4210 @@ namespace luanatic
 
     namespace detail
     {
-        //@TODO: LuanaticState should be STICK_API and in main namespace
-        struct STICK_LOCAL LuanaticState
+        //fixed size slot allocator backing StorageMode::Pooled classes. Slots are carved out of
+        //slabs that come from the state allocator and are recycled through an intrusive free list.
+        //Slabs are only given back when the pool is destroyed.
+        class STICK_LOCAL ObjectPool
         {
-            struct WrappedClass
+        public:
+
+            ObjectPool(stick::Allocator & _allocator, stick::Size _objectSize, stick::Size _alignment, stick::Size _slabSize) :
+                m_allocator(&_allocator),
+                m_alignment(std::max(_alignment, alignof(FreeSlot))),
+                m_slotSize(alignUp(std::max(_objectSize, sizeof(FreeSlot)), m_alignment)),
+                m_slabSize(_slabSize),
+                m_freeList(nullptr),
+                m_slabs(nullptr)
             {
-                ClassWrapperUniquePtr wrapper;
-                stick::Int32 namespaceIndex;
+
+            }
+
+            ObjectPool(const ObjectPool &) = delete;
+            ObjectPool & operator = (const ObjectPool &) = delete;
+
+            ~ObjectPool()
+            {
+                while (m_slabs)
+                {
+                    Slab * next = m_slabs->next;
+                    m_allocator->deallocate(m_slabs->block);
+                    m_slabs = next;
+                }
+            }
+
+            //returns nullptr if a new slab was needed and could not be allocated
+            void * allocate()
+            {
+                if (!m_freeList && !addSlab())
+                    return nullptr;
+                FreeSlot * ret = m_freeList;
+                m_freeList = ret->next;
+                return ret;
+            }
+
+            void deallocate(void * _slot)
+            {
+                FreeSlot * slot = static_cast<FreeSlot *>(_slot);
+                slot->next = m_freeList;
+                m_freeList = slot;
+            }
+
+        private:
+
+            struct FreeSlot
+            {
+                FreeSlot * next;
             };
 
-            LuanaticState(stick::Allocator & _allocator) :
-                m_allocator(&_allocator)
+            struct Slab
+            {
+                Slab * next;
+                stick::Block block;
+            };
+
+            static stick::Size alignUp(stick::Size _size, stick::Size _alignment)
             {
+                return (_size + _alignment - 1) / _alignment * _alignment;
+            }
+
+            bool addSlab()
+            {
+                stick::Size headerSize = alignUp(sizeof(Slab), m_alignment);
+                stick::Block blk = m_allocator->allocate(headerSize + m_slotSize * m_slabSize,
+                                                         std::max(m_alignment, alignof(Slab)));
+                if (!blk.ptr)
+                    return false;
+                Slab * slab = static_cast<Slab *>(blk.ptr);
+                slab->next = m_slabs;
+                slab->block = blk;
+                m_slabs = slab;
 
+                //push the slots in reverse so that they are handed out in address order
+                char * slots = static_cast<char *>(blk.ptr) + headerSize;
+                for (stick::Size i = m_slabSize; i > 0; --i)
+                    deallocate(slots + (i - 1) * m_slotSize);
+                return true;
             }
 
             stick::Allocator * m_allocator;
-            stick::DynamicArray<stick::UniquePtr<DefaultArgsBase>> m_defaultArgStorage;
-            stick::HashMap<stick::TypeID, WrappedClass> m_typeIDClassMap;
+            stick::Size m_alignment;
+            stick::Size m_slotSize;
+            stick::Size m_slabSize;
+            FreeSlot * m_freeList;
+            Slab * m_slabs;
         };
 
-        inline LuanaticState * luanaticState(lua_State * _luaState)
+        //the lua_Alloc user data of states created with createLuaState(stick::Allocator &).
+        //Blocks up to MaxPooledSize bytes come from one ObjectPool per size class (multiples of
+        //Granularity), bigger ones go straight to the stick::Allocator. Lua tells us the old size
+        //of every block it frees or resizes, so no per block header is needed.
+        //The LuaAllocator destroys itself when lua frees the last block (the state itself) in lua_close.
+        class STICK_LOCAL LuaAllocator
         {
-            lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY);
-            if (!lua_isnil(_luaState, -1))
+        public:
+
+            static constexpr stick::Size Granularity = alignof(std::max_align_t);
+            static constexpr stick::Size MaxPooledSize = 256;
+            static constexpr stick::Size SizeClassCount = MaxPooledSize / Granularity;
+            //roughly the number of bytes allocated at once for a size class
+            static constexpr stick::Size SlabByteCount = 4096;
+
+            LuaAllocator(stick::Allocator & _allocator) :
+                m_allocator(&_allocator),
+                m_bOwnedByState(false),
+                m_stats({0, 0, 0, 0}),
+                m_adoptedBlocks(nullptr)
             {
-                lua_getfield(_luaState, -1, "LuanaticState");
-                if (lua_isuserdata(_luaState, -1))
+                stick::Size alignment = Granularity;
+                for (stick::Size i = 0; i < SizeClassCount; ++i)
                 {
-                    LuanaticState * ret = static_cast<LuanaticState *>(lua_touserdata(_luaState, -1));
-                    lua_pop(_luaState, 2);
-                    return ret;
+                    stick::Size slotSize = (i + 1) * Granularity;
+                    stick::Size slabSize = SlabByteCount / slotSize;
+                    m_pools.append(stick::makeUnique<ObjectPool>(_allocator, _allocator, slotSize, alignment, slabSize));
                 }
             }
-            else
-                lua_pop(_luaState, 1);
-
-            lua_pushstring(_luaState, "No Luanatic state associated with the provided lua_State!");
-            lua_error(_luaState);
-            return nullptr;
-        }
 
-        template <class T>
-        struct ObjectIdentifier
-        {
-            static void identify(lua_State * _luaState, const T * _obj)
+            ~LuaAllocator()
             {
-                lua_pushlightuserdata(_luaState, (void *)_obj);
+                //the pools never free single slots, so the adopted blocks are released here
+                while (m_adoptedBlocks)
+                {
+                    AdoptedBlock * next = m_adoptedBlocks->next;
+                    m_allocator->deallocate({reinterpret_cast<char *>(m_adoptedBlocks) - MaxPooledSize, m_adoptedBlocks->size});
+                    m_adoptedBlocks = next;
+                }
             }
-        };
 
-        template <class T>
-        inline bool checkBases(LuanaticState & _luanaticState,
-                               stick::TypeID _tid)
-        {
-            bool ret = false;
-            auto it = _luanaticState.m_typeIDClassMap.find(_tid);
-            if (it != _luanaticState.m_typeIDClassMap.end())
+            static void * allocFunction(void * _userData, void * _ptr, size_t _oldSize, size_t _newSize)
             {
-                auto & casts = (*it).value.wrapper->m_casts;
-                auto sit = casts.begin();
+                LuaAllocator * self = static_cast<LuaAllocator *>(_userData);
+                //if _ptr is nullptr, _oldSize encodes the kind of object lua is allocating
+                if (!_ptr)
+                    _oldSize = 0;
 
-                for (; sit != casts.end(); ++sit)
+                if (_newSize == 0)
                 {
-                    if ((*sit).m_typeID == stick::TypeInfoT<T>::typeID())
-                        return true;
+                    if (_ptr)
+                        self->deallocate(_ptr, _oldSize);
+                    return nullptr;
+                }
 
-                    ret = checkBases<T>(_luanaticState, (*sit).m_typeID);
+                void * ret;
+                if (!_ptr)
+                    ret = self->allocate(_newSize);
+                else if (!isPooled(_oldSize) && !isPooled(_newSize))
+                {
+                    ret = self->m_allocator->reallocate({_ptr, bigBlockSize(_oldSize)}, bigBlockSize(_newSize), Granularity).ptr;
+                    if (ret)
+                        self->m_stats.byteCount += _newSize - _oldSize;
+                }
+                else if (isPooled(_newSize) && sizeClass(_oldSize) == sizeClass(_newSize))
+                {
+                    //the slot is big enough already
+                    ret = _ptr;
+                    self->m_stats.byteCount += _newSize - _oldSize;
+                }
+                else
+                {
+                    //moving between size classes or between a pool and the allocator
+                    ret = self->allocate(_newSize);
                     if (ret)
-                        break;
+                    {
+                        std::memcpy(ret, _ptr, std::min(_oldSize, _newSize));
+                        self->deallocate(_ptr, _oldSize);
+                    }
+                    else if (_newSize < _oldSize)
+                    {
+                        //lua requires shrinking to never fail, so keep the old block
+                        ret = self->keepShrunkBlock(_ptr, _oldSize, _newSize);
+                    }
                 }
+                if (ret)
+                    self->m_stats.allocationCount++;
+                return ret;
             }
 
-            return ret;
-        }
+            stick::Allocator * m_allocator;
+            stick::DynamicArray<stick::UniquePtr<ObjectPool>> m_pools;
+            //set once the state was successfully created, after that freeing the last block destroys this
+            bool m_bOwnedByState;
+            LuaAllocatorStatistics m_stats;
 
-        struct FindCastFunctionResult
-        {
-            stick::Int32 castCount;
-            UserData userData;
-        };
+        private:
 
-        inline FindCastFunctionResult findCastFunctionImpl(LuanaticState & _luanaticState, const UserData & _currentUserData, stick::TypeID _targetTypeID, stick::Int32 _depth)
-        {
-            UserData ret = _currentUserData;
+            //lives behind the first MaxPooledSize bytes of a big block that was kept for a pooled size,
+            //see keepShrunkBlock
+            struct AdoptedBlock
+            {
+                AdoptedBlock * next;
+                stick::Size size;
+            };
+
+            static bool isPooled(stick::Size _size)
+            {
+                return _size <= MaxPooledSize;
+            }
 
-            auto fit = _luanaticState.m_typeIDClassMap.find(ret.m_typeID);
-            if (fit == _luanaticState.m_typeIDClassMap.end())
-                return { -1, ret};
-            auto & casts = fit->value.wrapper->m_casts;
-            auto it = casts.begin();
+            //big blocks always have room for an AdoptedBlock behind the bytes a pool slot can use
+            static stick::Size bigBlockSize(stick::Size _size)
+            {
+                return std::max(_size, MaxPooledSize + sizeof(AdoptedBlock));
+            }
 
-            // check direct bases
-            for (; it != casts.end(); ++it)
+            //Called if a block could not be moved to the size class of _newSize. Lua passes _newSize
+            //as the old size from now on, so the block is handed to the pool of that size class once it
+            //gets freed. A slot of a bigger size class fits just fine, as the pools are plain free lists
+            //that only release their slabs. Big blocks are remembered so they can be released in the
+            //destructor.
+            void * keepShrunkBlock(void * _ptr, stick::Size _oldSize, stick::Size _newSize)
             {
-                ret = (*it).m_cast(_currentUserData, _luanaticState);
-                if (ret.m_typeID == _targetTypeID)
+                STICK_ASSERT(isPooled(_newSize) && sizeClass(_newSize) != sizeClass(_oldSize));
+                if (!isPooled(_oldSize))
                 {
-                    return { _depth, ret };
+                    AdoptedBlock * adopted = reinterpret_cast<AdoptedBlock *>(static_cast<char *>(_ptr) + MaxPooledSize);
+                    adopted->next = m_adoptedBlocks;
+                    adopted->size = bigBlockSize(_oldSize);
+                    m_adoptedBlocks = adopted;
                 }
+                m_stats.byteCount -= _oldSize - _newSize;
+                return _ptr;
             }
 
-            it = casts.begin();
+            static stick::Size sizeClass(stick::Size _size)
+            {
+                return (_size - 1) / Granularity;
+            }
 
-            // recursively walk the inheritance tree
-            for (; it != casts.end(); ++it)
+            void * allocate(stick::Size _size)
             {
-                ret = (*it).m_cast(_currentUserData, _luanaticState);
-                auto res = findCastFunctionImpl(_luanaticState, ret, _targetTypeID, _depth + 1);
-                if (res.userData.m_typeID == _targetTypeID)
-                    return res;
+                void * ret;
+                if (isPooled(_size))
+                {
+                    ret = m_pools[sizeClass(_size)]->allocate();
+                    if (ret)
+                        m_stats.pooledAllocationCount++;
+                }
+                else
+                    ret = m_allocator->allocate(bigBlockSize(_size), Granularity).ptr;
+
+                if (ret)
+                {
+                    m_stats.byteCount += _size;
+                    m_stats.blockCount++;
+                }
+                return ret;
             }
 
-            return { -1, ret };
-        }
+            void deallocate(void * _ptr, stick::Size _size)
+            {
+                if (isPooled(_size))
+                    m_pools[sizeClass(_size)]->deallocate(_ptr);
+                else
+                    m_allocator->deallocate({_ptr, bigBlockSize(_size)});
 
-        inline FindCastFunctionResult findCastFunction(LuanaticState & _luanaticState, const UserData & _currentUserData, stick::TypeID _targetTypeID)
+                m_stats.byteCount -= _size;
+                if (--m_stats.blockCount == 0 && m_bOwnedByState)
+                    m_allocator->destroy(this);
+            }
+
+            AdoptedBlock * m_adoptedBlocks;
+        };
+
+        //same as the panic function installed by luaL_newstate
+        inline stick::Int32 luaPanic(lua_State * _luaState)
         {
-            return findCastFunctionImpl(_luanaticState, _currentUserData, _targetTypeID, 0);
+            std::fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n", lua_tostring(_luaState, -1));
+            return 0;
         }
 
-        inline void pushGlobalsTable(lua_State * _state)
+        //same as the allocation function installed by luaL_newstate, used by createLuaState()
+        inline void * defaultLuaAlloc(void *, void * _ptr, size_t, size_t _newSize)
         {
-#if LUA_VERSION_NUM >= 502
-            lua_pushglobaltable(_state);
-#else
-            lua_pushvalue(_state, LUA_GLOBALSINDEX);
-#endif // LUA_VERSION_NUM >= 502
+            if (_newSize == 0)
+            {
+                std::free(_ptr);
+                return nullptr;
+            }
+            return std::realloc(_ptr, _newSize);
         }
 
-        // wrapper around either lua_objlen (5.1) or lua_rawlen(5.2)
-        inline stick::Size rawLen(lua_State * _state, int _index)
+        //the lua_Alloc user data of states created with createLuaState(lua_Alloc, void *). It forwards
+        //to the user provided function and frees itself together with the main thread in lua_close.
+        struct STICK_LOCAL ForwardingLuaAlloc
         {
-#if LUA_VERSION_NUM >= 502
-            return lua_rawlen(_state, _index);
-#else
-            return lua_objlen(_state, _index);
-#endif // LUA_VERSION_NUM >= 502
-        }
-
-        using Overloads = stick::DynamicArray<LuanaticFunction>;
+            lua_Alloc m_allocFunction;
+            void * m_userData;
+            //the first block lua allocates, which is also the last one it frees
+            void * m_mainThreadBlock;
+            //only set once lua_newstate succeeded, createLuaState frees the forwarder otherwise
+            bool m_bOwnedByState;
 
-        struct EvaluatedOverload
-        {
-            LuanaticFunction function;
-            stick::Int32 defArgsToPush;
+            static void * allocFunction(void * _userData, void * _ptr, size_t _oldSize, size_t _newSize)
+            {
+                ForwardingLuaAlloc * self = static_cast<ForwardingLuaAlloc *>(_userData);
+                void * ret = self->m_allocFunction(self->m_userData, _ptr, _oldSize, _newSize);
+                if (!self->m_mainThreadBlock)
+                    self->m_mainThreadBlock = ret;
+                else if (_newSize == 0 && _ptr == self->m_mainThreadBlock && self->m_bOwnedByState)
+                    self->m_allocFunction(self->m_userData, self, sizeof(ForwardingLuaAlloc), 0);
+                return ret;
+            }
         };
 
-        inline stick::Int32 callOverloadedFunction(lua_State * _luaState)
+        //@TODO: LuanaticState should be STICK_API and in main namespace
+        struct STICK_LOCAL LuanaticState
         {
-            stick::Int32 argCount = lua_gettop(_luaState);
-            lua_pushvalue(_luaState, lua_upvalueindex(1));
-            STICK_ASSERT(lua_isuserdata(_luaState, -1));
-            Overloads * overloads = (Overloads *)lua_touserdata(_luaState, -1);
-            lua_pop(_luaState, 1);
-            EvaluatedOverload candidates[16];
-            stick::Int32 defArgsToPush = 0;
-            stick::Size idx = 0;
-            stick::Int32 bestScore = std::numeric_limits<stick::Int32>::max();
-            for (auto it = overloads->begin(); it != overloads->end(); ++it)
+            struct CastTableEntry
             {
-                stick::Int32 score = (*it).scoreFunction(_luaState, argCount, (*it).defaultArgs ? (*it).defaultArgs->argCount() : 0, &defArgsToPush);
-                if (score != std::numeric_limits<stick::Int32>::max()  && score == bestScore)
-                {
-                    candidates[idx++] = {*it, defArgsToPush};
-                }
-                else if (score < bestScore)
-                {
-                    idx = 0;
-                    candidates[idx++] = {*it, defArgsToPush};
-                    bestScore = score;
-                }
+                stick::TypeID typeID;
+                //number of casts needed to get to typeID, 1 for direct bases
+                stick::Int32 depth;
+                //the casts to apply in order are castChains[chainStart] to castChains[chainStart + depth]
+                stick::Size chainStart;
+            };
 
-                if (idx == 15)
-                    break;
-            }
+            using CastTable = stick::DynamicArray<CastTableEntry>;
+            using CastChainArray = stick::DynamicArray<UserDataCastFunction::CastFunction>;
 
-            if (!idx)
+            using AncestorBits = stick::DynamicArray<stick::UInt64>;
+
+            struct WrappedClass
             {
-                stick::String str;
-                for (stick::Size i = 0; i < overloads->count(); i++)
-                {
-                    if (i < overloads->count() - 1)
-                        str.append(stick::AppendVariadicFlag(), "   ", (*overloads)[i].signatureStrFunction(), ",\n");
-                    else
-                        str.append(stick::AppendVariadicFlag(), "   ", (*overloads)[i].signatureStrFunction(), "\n");
-                }
-                luaErrorWithStackTrace(_luaState, 1, "\nCould not find candidate for overloaded function, Candidates:\n%s", str.cString());
-            }
-            else if (idx > 1)
+                ClassWrapperUniquePtr wrapper;
+                stick::Int32 namespaceIndex;
+                //all casts reachable from this class, see buildCastTable
+                CastTable castTable;
+                CastChainArray castChains;
+                //bit n is set if the class with index n is reachable through castTable
+                AncestorBits ancestorBits;
+                stick::Size castTableGeneration;
+                //registry reference to the class table (which is the metatable of instances)
+                //used to set the metatable of new userdata, and its address for identity checks
+                stick::Int32 metatableRef;
+                const void * metatable;
+                //registry reference to the weak table of borrowed userdata if the class caches them, LUA_NOREF otherwise
+                stick::Int32 borrowedCacheRef;
+                //slot pool of StorageMode::Pooled classes, owned by LuanaticState::m_pools
+                ObjectPool * pool;
+            };
+
+            LuanaticState(stick::Allocator & _allocator) :
+                m_allocator(&_allocator),
+                m_registrationGeneration(nextRegistrationGeneration()),
+                m_bufferMetatableRef(LUA_NOREF)
             {
-                stick::String str;
-                for (stick::Int32 i = 0; i < idx; i++)
-                {
-                    if (i < idx - 1)
-                        str.append(stick::AppendVariadicFlag(), "   ", candidates[i].function.signatureStrFunction(), ",\n");
-                    else
-                        str.append(stick::AppendVariadicFlag(), "   ", candidates[i].function.signatureStrFunction(), "\n");
-                }
-                luaErrorWithStackTrace(_luaState, 1, "\nAmbiguous call to overloaded function, Candidates:\n%s", str.cString());
+
             }
-            else
+
+            //generations are unique across all states (not only increasing per state), so a
+            //generation alone identifies a state and its set of registered classes
+            static stick::Size nextRegistrationGeneration()
             {
-                //call the function we found it, make sure to push the default arguments if any
-                if (candidates[0].function.defaultArgs && candidates[0].defArgsToPush > 0)
-                {
-                    candidates[0].function.defaultArgs->push(_luaState, candidates[0].defArgsToPush);
-                }
-                return candidates[0].function.function(_luaState);
+                static std::atomic<stick::Size> s_generation(0);
+                return ++s_generation;
             }
 
-            return 0;
-        }
+            stick::Allocator * m_allocator;
+            //changed whenever a class is registered, used to invalidate cached lookups
+            stick::Size m_registrationGeneration;
+            stick::DynamicArray<stick::UniquePtr<DefaultArgsBase>> m_defaultArgStorage;
+            //registered classes, indexed by their dense class index - 1 (0 is never a valid index)
+            stick::DynamicArray<WrappedClass> m_classes;
+            stick::HashMap<stick::TypeID, stick::UInt32> m_typeIDClassIndexMap;
+            //pools outlive the class registrations they were created for, as objects allocated
+            //from them might still be alive after a class got registered again
+            stick::DynamicArray<stick::UniquePtr<ObjectPool>> m_pools;
+            //registry reference to the metatable shared by all buffers, see pushBuffer
+            stick::Int32 m_bufferMetatableRef;
+        };
 
-        inline stick::Int32 callConstructorNice(lua_State * _luaState)
+        //returns the dense class index for _tid or 0 if the type is not registered
+        inline stick::UInt32 findClassIndex(LuanaticState & _luanaticState, stick::TypeID _tid)
         {
-            //for nice constructor we need to pop the first stack item
-            lua_remove(_luaState, 1);
+            auto it = _luanaticState.m_typeIDClassIndexMap.find(_tid);
+            return it != _luanaticState.m_typeIDClassIndexMap.end() ? it->value : 0;
+        }
 
-            stick::Int32 argCount = lua_gettop(_luaState);
+        //per type cache of the class index, saves the hash lookup in findClassIndex when the same
+        //type is pushed repeatedly. It is only valid for the state generation it was filled in,
+        //and thread local so that states living on different threads don't race on it.
+        template<class T>
+        struct ClassIndexCache
+        {
+            static thread_local stick::Size s_generation;
+            static thread_local stick::UInt32 s_classIndex;
+        };
 
-            //push the actual constructor onto the stack
-            stick::Int32 idx = lua_upvalueindex(1);
-            lua_pushvalue(_luaState, idx);
+        template<class T>
+        thread_local stick::Size ClassIndexCache<T>::s_generation = 0;
 
-            //insert it before the arguments
-            lua_insert(_luaState, -1 - argCount);
+        template<class T>
+        thread_local stick::UInt32 ClassIndexCache<T>::s_classIndex = 0;
 
-            //and call it
-            lua_call(_luaState, argCount, 1);
+        //same as findClassIndex(_luanaticState, TypeInfoT<T>::typeID()), using ClassIndexCache<T>
+        template<class T>
+        inline stick::UInt32 classIndexOf(LuanaticState & _luanaticState)
+        {
+            using Cache = ClassIndexCache<T>;
+            if (Cache::s_generation != _luanaticState.m_registrationGeneration)
+            {
+                Cache::s_classIndex = findClassIndex(_luanaticState, stick::TypeInfoT<T>::typeID());
+                Cache::s_generation = _luanaticState.m_registrationGeneration;
+            }
+            return Cache::s_classIndex;
+        }
 
-            return 1;
+        inline LuanaticState::WrappedClass & classAt(LuanaticState & _luanaticState, stick::UInt32 _classIndex)
+        {
+            STICK_ASSERT(_classIndex > 0 && _classIndex <= _luanaticState.m_classes.count());
+            return _luanaticState.m_classes[_classIndex - 1];
         }
 
-        void registerFunctions(lua_State * _luaState, stick::Int32 _targetTableIndex,
-                               const ClassWrapperBase::NamedLuaFunctionArray & _functions,
-                               const stick::String & _nameReplace = "",
-                               bool _bNiceConstructor = false)
+        inline LuanaticState::WrappedClass * findClass(LuanaticState & _luanaticState, stick::TypeID _tid)
         {
-            STICK_ASSERT(lua_istable(_luaState, _targetTableIndex));
-            STICK_ASSERT(lua_istable(_luaState, -1));
-            auto it = _functions.begin();
-            const char * name;
+            stick::UInt32 idx = findClassIndex(_luanaticState, _tid);
+            return idx ? &classAt(_luanaticState, idx) : nullptr;
+        }
 
-            //if there is no overload table in target scope, create it
-            lua_getfield(_luaState, _targetTableIndex, "__overloads");
-            if (lua_isnil(_luaState, -1))
+        inline LuanaticState * luanaticStateFromRegistry(lua_State * _luaState)
+        {
+            lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY);
+            if (!lua_isnil(_luaState, -1))
             {
-                lua_newtable(_luaState); // ... CT mT {}
-                lua_setfield(_luaState, _targetTableIndex, "__overloads"); // ... CT mT
+                lua_getfield(_luaState, -1, "LuanaticState");
+                if (lua_isuserdata(_luaState, -1))
+                {
+                    LuanaticState * ret = static_cast<LuanaticState *>(lua_touserdata(_luaState, -1));
+                    lua_pop(_luaState, 2);
+                    return ret;
+                }
+                lua_pop(_luaState, 2);
             }
-            lua_pop(_luaState, 1);
+            else
+                lua_pop(_luaState, 1);
+
+            lua_pushstring(_luaState, "No Luanatic state associated with the provided lua_State!");
+            lua_error(_luaState);
+            return nullptr;
+        }
 
+#ifdef LUANATIC_USE_EXTRASPACE
+        static_assert(LUA_EXTRASPACE >= sizeof(void *), "LUA_EXTRASPACE is too small to hold the LuanaticState, define LUANATIC_NO_EXTRASPACE");
 
-            LuanaticState * lstate = luanaticState(_luaState);
-            STICK_ASSERT(lstate);
+        inline LuanaticState *& extraSpaceLuanaticState(lua_State * _luaState)
+        {
+            return *static_cast<LuanaticState **>(lua_getextraspace(_luaState));
+        }
+#endif //LUANATIC_USE_EXTRASPACE
 
-            for (; it != _functions.end(); ++it)
+#ifdef LUANATIC_USE_EXTRASPACE
+        //lua_newstate does not initialize the extra space of the main thread and lua_newthread copies
+        //it from there, so it only holds nullptr or a valid LuanaticState if the state was created through
+        //one of the createLuaState functions, which zero it right away. They are recognized by their
+        //lua_Alloc, which is only used by luanatic.
+        inline bool hasLuanaticExtraSpace(lua_State * _luaState)
+        {
+            lua_Alloc allocFunction = lua_getallocf(_luaState, nullptr);
+            return allocFunction == defaultLuaAlloc ||
+                   allocFunction == LuaAllocator::allocFunction ||
+                   allocFunction == ForwardingLuaAlloc::allocFunction;
+        }
+#endif //LUANATIC_USE_EXTRASPACE
+
+        inline LuanaticState * luanaticState(lua_State * _luaState)
+        {
+#ifdef LUANATIC_USE_EXTRASPACE
+            if (hasLuanaticExtraSpace(_luaState))
             {
-                name = _nameReplace.length() ? _nameReplace.cString()
-                       : (*it).name.cString();
-                lua_getfield(_luaState, -1, name); // ... CT mT mT[name]
+                LuanaticState *& cached = extraSpaceLuanaticState(_luaState);
+                if (cached)
+                    return cached;
+                //threads that were created before initialize was called don't have it cached yet
+                cached = luanaticStateFromRegistry(_luaState);
+                return cached;
+            }
+#endif //LUANATIC_USE_EXTRASPACE
+            return luanaticStateFromRegistry(_luaState);
+        }
 
-                //the luastate owns the default args
-                if ((*it).function.defaultArgs)
-                    lstate->m_defaultArgStorage.append(stick::UniquePtr<DefaultArgsBase>((*it).function.defaultArgs, stick::defaultAllocator()));
+        template <class T>
+        struct ObjectIdentifier
+        {
+            static void identify(lua_State * _luaState, const T * _obj)
+            {
+                lua_pushlightuserdata(_luaState, (void *)_obj);
+            }
+        };
 
-                if (lua_isnil(_luaState, -1))
+        //flattens all casts reachable from a class (breadth first, so every ancestor
+        //is reached through the shortest chain of casts)
+        inline void buildCastTable(LuanaticState & _luanaticState, LuanaticState::WrappedClass & _wc)
+        {
+            auto contains = [&_wc](stick::TypeID _tid)
+            {
+                if (_tid == _wc.wrapper->m_typeID)
+                    return true;
+                for (stick::Size i = 0; i < _wc.castTable.count(); ++i)
                 {
-                    //copy the function into the overloaded table (this is kinda not super memory efficient)
-                    //if you don't use overloaded functions, but we need to store it somewhere, better ideas?
-                    //@TODO: Better ideas that don't use this extra memory and don't compromise speed?
-                    lua_getfield(_luaState, _targetTableIndex, "__overloads"); // ... CT mT nil __overloads
-                    pushUnregisteredType(_luaState, Overloads()); // ... CT mT nil __overloads ola
-                    lua_pushvalue(_luaState, -1); // ... CT mT nil __overloads ola ola
-                    Overloads * overloads = (Overloads *)lua_touserdata(_luaState, -1);
-                    overloads->append((*it).function);
+                    if (_wc.castTable[i].typeID == _tid)
+                        return true;
+                }
+                return false;
+            };
 
-                    lua_setfield(_luaState, -3, name); // ... CT mT nil __overloads ola
+            _wc.castTable.clear();
+            _wc.castChains.clear();
+            _wc.ancestorBits.clear();
+            _wc.ancestorBits.resize((_luanaticState.m_classes.count() + 1 + 63) / 64, 0);
 
-                    if (!(*it).function.defaultArgs)
-                    {
-                        lua_pop(_luaState, 2); // ... CT mT nil
-                        lua_pushstring(_luaState, name); // ... CT mT nil name
-                        lua_pushcfunction(_luaState, (*it).function.function); // ... CT mT nil name func
-                        if (_bNiceConstructor)
-                        {
-                            lua_pushcclosure(_luaState, callConstructorNice, 1);
-                        }
-                        lua_settable(_luaState, -4); // ... CT mT nil
-                        lua_pop(_luaState, 1); // ... CT mT
-                    }
-                    else
-                    {
-                        lua_pushcclosure(_luaState, callOverloadedFunction, 1); // ... CT mT nil __overloads closure
-                        if (_bNiceConstructor)
-                        {
-                            lua_pushcclosure(_luaState, callConstructorNice, 1);
-                        }
-                        lua_setfield(_luaState, -4, name); // ... CT mT __overloads nil
-                        lua_pop(_luaState, 2); // ... CT mT g
-                    }
-                }
-                else
+            for (stick::Size i = 0; i < _wc.wrapper->m_casts.count(); ++i)
+            {
+                const UserDataCastFunction & cast = _wc.wrapper->m_casts[i];
+                if (contains(cast.m_typeID))
+                    continue;
+                _wc.castTable.append({cast.m_typeID, 1, _wc.castChains.count()});
+                _wc.castChains.append(cast.m_cast);
+            }
+
+            //the cast table itself serves as the queue
+            for (stick::Size i = 0; i < _wc.castTable.count(); ++i)
+            {
+                LuanaticState::CastTableEntry entry = _wc.castTable[i];
+                stick::UInt32 classIndex = findClassIndex(_luanaticState, entry.typeID);
+                if (!classIndex)
+                    continue;
+
+                _wc.ancestorBits[classIndex / 64] |= stick::UInt64(1) << (classIndex % 64);
+                auto & casts = classAt(_luanaticState, classIndex).wrapper->m_casts;
+                for (stick::Size j = 0; j < casts.count(); ++j)
                 {
-                    lua_getfield(_luaState, _targetTableIndex, "__overloads"); // ... CT mT __overloads
-                    lua_getfield(_luaState, -1, name); // ... CT mT __overloads namefield
-                    STICK_ASSERT(lua_isuserdata(_luaState, -1));
-                    Overloads * overloads = (Overloads *)lua_touserdata(_luaState, -1);
-                    overloads->append((*it).function);
+                    if (contains(casts[j].m_typeID))
+                        continue;
 
-                    //push the c closure and set the overloaded
-                    lua_pushcclosure(_luaState, callOverloadedFunction, 1); // ... CT mT __overloads namefield closure
-                    if (_bNiceConstructor)
+                    stick::Size chainStart = _wc.castChains.count();
+                    for (stick::Int32 k = 0; k < entry.depth; ++k)
                     {
-                        lua_pushcclosure(_luaState, callConstructorNice, 1);
+                        UserDataCastFunction::CastFunction func = _wc.castChains[entry.chainStart + k];
+                        _wc.castChains.append(func);
                     }
-                    lua_setfield(_luaState, -4, name); // ... CT mT __overloads namefield
-                    lua_pop(_luaState, 2); // ... CT mT
+                    _wc.castChains.append(casts[j].m_cast);
+                    _wc.castTable.append({casts[j].m_typeID, entry.depth + 1, chainStart});
                 }
             }
-        }
-
-        template <class T>
-        inline stick::Int32 newIndex(lua_State * _luaState);
 
-        template <class T>
-        inline stick::Int32 index(lua_State * _luaState);
+            _wc.castTableGeneration = _luanaticState.m_registrationGeneration;
+        }
 
-        template <class T>
-        stick::Int32 destruct(lua_State * _luaState);
+        inline LuanaticState::WrappedClass & castTableClass(LuanaticState & _luanaticState, stick::UInt32 _classIndex)
+        {
+            LuanaticState::WrappedClass & wc = classAt(_luanaticState, _classIndex);
+            //casts to classes that were registered later might have become reachable
+            if (wc.castTableGeneration != _luanaticState.m_registrationGeneration)
+                buildCastTable(_luanaticState, wc);
+            return wc;
+        }
 
-        template <class T>
-        inline stick::Int32 destructUnregistered(lua_State * _luaState);
+        //returns true if the class at _ancestorIndex can be reached by casting the class at _classIndex
+        inline bool hasAncestor(LuanaticState & _luanaticState, stick::UInt32 _classIndex, stick::UInt32 _ancestorIndex)
+        {
+            const LuanaticState::WrappedClass & wc = castTableClass(_luanaticState, _classIndex);
+            return _ancestorIndex / 64 < wc.ancestorBits.count() &&
+                   (wc.ancestorBits[_ancestorIndex / 64] & (stick::UInt64(1) << (_ancestorIndex % 64)));
+        }
 
+        //returns the cast table entry to get from the class at _classIndex to _to or nullptr if there is none
+        inline const LuanaticState::CastTableEntry * findCastTableEntry(LuanaticState & _luanaticState,
+                stick::UInt32 _classIndex,
+                stick::TypeID _to,
+                LuanaticState::WrappedClass ** _outClass = nullptr)
+        {
+            if (!_classIndex)
+                return nullptr;
 
-        template<bool bHasDestructor>
-        struct DestructorRegistration;
+            LuanaticState::WrappedClass & wc = castTableClass(_luanaticState, _classIndex);
+            if (_outClass)
+                *_outClass = &wc;
 
-        template<>
-        struct DestructorRegistration<false>
-        {
-            template<class T>
-            static void registerDestructor(lua_State * _state, stick::Int32 _classTableIndex)
+            for (stick::Size i = 0; i < wc.castTable.count(); ++i)
             {
-
+                if (wc.castTable[i].typeID == _to)
+                    return &wc.castTable[i];
             }
-        };
+            return nullptr;
+        }
 
-        template<>
-        struct DestructorRegistration<true>
+        //returns the number of casts needed to get from the class at _classIndex to _to (1 for a direct base) or -1
+        inline stick::Int32 castDepth(LuanaticState & _luanaticState, stick::UInt32 _classIndex, stick::TypeID _to)
         {
-            template<class T>
-            static void registerDestructor(lua_State * _state, stick::Int32 _classTableIndex)
-            {
-                lua_pushliteral(_state, "__gc");                // ... CT mT __gc
-                lua_pushcfunction(_state, destruct<T>); // ... CT mT  __gc gfunc
-                lua_settable(_state, _classTableIndex);               // ... CT mT
-            }
-        };
+            auto entry = findCastTableEntry(_luanaticState, _classIndex, _to);
+            return entry ? entry->depth : -1;
+        }
 
-        template <class CW, bool bHasDestructor = true>
-        inline void registerClass(lua_State * _state, const CW & _wrapper)
+        //the class index of the stored type WT when pushing it with the metatable of T
+        template<class T, class WT>
+        inline stick::UInt32 wrappedTypeClassIndex(LuanaticState & _luanaticState, stick::UInt32 _classIndexOfT)
         {
-            using ClassType = typename CW::ClassType;
+            return std::is_same<T, WT>::value ? _classIndexOfT : classIndexOf<WT>(_luanaticState);
+        }
 
-            //NOTE: Call this function with the namespace table that you want to
-            //register the class to on top of the stack.
+        //the class index of userdata pushed by luanatic, looked up by type for userdata created elsewhere
+        inline stick::UInt32 userDataClassIndex(LuanaticState & _luanaticState, const UserData & _ud)
+        {
+            return _ud.m_classIndex && _ud.m_classIndex <= _luanaticState.m_classes.count() ?
+                   _ud.m_classIndex : findClassIndex(_luanaticState, _ud.m_typeID);
+        }
 
-            LuanaticState * state = luanaticState(_state);
-            STICK_ASSERT(state != nullptr);
+        //fast path to identify userdata pushed by luanatic, compares its metatable against the
+        //cached metatable of the class it claims to be. Returns the class index or 0 if the
+        //slow path (__typeID lookup) has to be taken.
+        inline stick::UInt32 identifyUserData(lua_State * _luaState, stick::Int32 _index, LuanaticState & _luanaticState)
+        {
+            if (lua_type(_luaState, _index) != LUA_TUSERDATA || rawLen(_luaState, _index) < sizeof(UserData))
+                return 0;
 
-            ClassWrapperUniquePtr cl = stick::makeUnique<CW>(*state->m_allocator, _wrapper);
-            ClassWrapperBase * rep = cl.get();
+            UserData * pud = static_cast<UserData *>(lua_touserdata(_luaState, _index));
+            if (!pud->m_classIndex || pud->m_classIndex > _luanaticState.m_classes.count() ||
+                    !lua_getmetatable(_luaState, _index))
+                return 0;
 
-            //make sure all the bases are registered
-            auto it = _wrapper.m_bases.begin();
-            for (; it != _wrapper.m_bases.end(); ++it)
-            {
-                auto mit = state->m_typeIDClassMap.find((*it));
+            bool bMatch = lua_topointer(_luaState, -1) == classAt(_luanaticState, pud->m_classIndex).metatable;
+            lua_pop(_luaState, 1);
+            return bMatch ? pud->m_classIndex : 0;
+        }
 
-                if (mit == state->m_typeIDClassMap.end())
-                {
-                    luaL_error(_state, "attempting to extend a type that has not been registered");
-                }
-            }
+        struct FindCastFunctionResult
+        {
+            stick::Int32 castCount;
+            UserData userData;
+        };
 
-            //cl->m_bases = bases;
-            stick::TypeID myTypeID = cl->m_typeID;
-            lua_pushvalue(_state, -1);
-            state->m_typeIDClassMap[_wrapper.m_typeID] = {std::move(cl), luaL_ref(_state, LUA_REGISTRYINDEX)};
+        inline FindCastFunctionResult findCastFunction(LuanaticState & _luanaticState, const UserData & _currentUserData, stick::TypeID _targetTypeID)
+        {
+            LuanaticState::WrappedClass * wc;
+            auto entry = findCastTableEntry(_luanaticState, userDataClassIndex(_luanaticState, _currentUserData), _targetTypeID, &wc);
+            if (!entry)
+                return { -1, _currentUserData };
 
-            //the class table
-            lua_newtable(_state); // ... CT
-            stick::Int32 classTable = lua_gettop(_state);
-            lua_pushstring(_state, _wrapper.m_className.cString()); // ... CT "className"
-            lua_pushvalue(_state, classTable);                      // ... CT "className" CT
-            lua_settable(_state, -4);                               // ... CT
-
-            //add a metatable to the class table with a __call metamethod to allow nice constructors such as MyClass()
-            //instead of MyClass.new()
-            lua_newtable(_state); // ... CT {}
-            stick::Int32 classMetaTable = lua_gettop(_state);
-            registerFunctions(_state, classMetaTable, _wrapper.m_constructors, "__call", true);
-            lua_setmetatable(_state, classTable); // ... CT
-
-            //register static functions in class table
-            registerFunctions(_state, classTable, _wrapper.m_statics);
-
-            lua_pushliteral(_state, "__typeID");            // ... CT __typeID
-            lua_pushlightuserdata(_state, myTypeID);        // ... CT __typeID id
-            lua_settable(_state, classTable);               // ... CT
-
-            lua_pushliteral(_state, "__index");             // ... CT mT __index
-            lua_pushcfunction(_state, index<ClassType>);    // ... CT mT __index ifunc
-            lua_settable(_state, classTable);               // ... CT mT
-            lua_pushliteral(_state, "__newindex");          // ... CT mT __newindex
-            lua_pushcfunction(_state, newIndex<ClassType>); // ... CT mT __newindex nifunc
-            lua_settable(_state, classTable);               // ... CT mT
-            //lua_pushliteral(_state, "__overloads");
-            //lua_newtable(_state);
-            //lua_settable(_state, classTable); // ... CT mT
-            lua_pushliteral(_state, "__className");
-            lua_pushstring(_state, _wrapper.m_className.cString());
-            lua_settable(_state, classTable); // ... CT mT
-
-            //register member functions
-            registerFunctions(_state, classTable, _wrapper.m_members);
+            UserData ret = _currentUserData;
+            for (stick::Int32 i = 0; i < entry->depth; ++i)
+                ret = wc->castChains[entry->chainStart + i](ret, _luanaticState);
+            return { entry->depth - 1, ret };
+        }
 
-            //destructor
-            using DesReg = DestructorRegistration<bHasDestructor>;
-            DesReg::template registerDestructor<ClassType>(_state, classTable);
+        inline void pushGlobalsTable(lua_State * _state)
+        {
+#if LUA_VERSION_NUM >= 502
+            lua_pushglobaltable(_state);
+#else
+            lua_pushvalue(_state, LUA_GLOBALSINDEX);
+#endif // LUA_VERSION_NUM >= 502
+        }
 
-            lua_newtable(_state); // ... CT mT {}
-            //register attributes if provided
-            registerFunctions(_state, lua_gettop(_state), _wrapper.m_attributes); //... CT mT
-            lua_setfield(_state, -2, "__attributes");                       // ... CT mT
+        // wrapper around either lua_objlen (5.1) or lua_rawlen(5.2)
+        inline stick::Size rawLen(lua_State * _state, int _index)
+        {
+#if LUA_VERSION_NUM >= 502
+            return lua_rawlen(_state, _index);
+#else
+            return lua_objlen(_state, _index);
+#endif // LUA_VERSION_NUM >= 502
+        }
 
-            //create a table that holds the base classes
-            lua_newtable(_state);                // ... CT {}
-            lua_setfield(_state, -2, "__bases"); // ... CT
+        // wrapper around lua_absindex (5.2), turns _index into an index that stays valid when pushing
+        inline int absIndex(lua_State * _state, int _index)
+        {
+#if LUA_VERSION_NUM >= 502
+            return lua_absindex(_state, _index);
+#else
+            return _index > 0 || _index <= LUA_REGISTRYINDEX ? _index : lua_gettop(_state) + _index + 1;
+#endif // LUA_VERSION_NUM >= 502
+        }
 
-            lua_pop(_state, 1); // ...
+        // pushes the uservalue (5.2+) or environment (5.1) of the userdata at _index
+        inline void pushUserValue(lua_State * _state, int _index)
+        {
+#if LUA_VERSION_NUM >= 504
+            lua_getiuservalue(_state, _index, 1);
+#elif LUA_VERSION_NUM >= 502
+            lua_getuservalue(_state, _index);
+#else
+            lua_getfenv(_state, _index);
+#endif // LUA_VERSION_NUM >= 504
+        }
 
-            //now merge all the base metatables with this metatable for access speed
-            auto sit = rep->m_bases.begin();
+        // pops a table and sets it as the uservalue (5.2+) or environment (5.1) of the userdata at _index
+        inline void setUserValue(lua_State * _state, int _index)
+        {
+#if LUA_VERSION_NUM >= 504
+            lua_setiuservalue(_state, _index, 1);
+#elif LUA_VERSION_NUM >= 502
+            lua_setuservalue(_state, _index);
+#else
+            lua_setfenv(_state, _index);
+#endif // LUA_VERSION_NUM >= 504
+        }
 
-            stick::Size baseID = 1;
-            for (; sit != rep->m_bases.end(); ++sit)
+#if LUA_VERSION_NUM < 503
+        int lua_isinteger (lua_State * _state, stick::Int32 _index)
+        {
+            if (lua_type(_state, _index) == LUA_TNUMBER)
             {
-                const LuanaticState::WrappedClass & wc = state->m_typeIDClassMap[*sit];
-                //insert BASE class table in the __bases table of T's ClassTable
-                lua_getfield(_state, -1, _wrapper.m_className.cString()); // ... CT
-                lua_getfield(_state, -1, "__bases");                    // ... CT __bases
-                stick::Int32 basesCount = baseID++;
-                lua_pushinteger(_state, basesCount);                   // ... CT __bases i
-                lua_rawgeti(_state, LUA_REGISTRYINDEX, wc.namespaceIndex); // ... CT __bases i nT
-                lua_getfield(_state, -1, wc.wrapper->m_className.cString()); // ... CT __bases i nT CB
-                lua_remove(_state, -2);                                // ... CT __bases i CB
-                lua_settable(_state, -3);                              // ... CT __bases
-                lua_pop(_state, 2);                                    // ...
+                lua_Number n = lua_tonumber(_state, _index);
+                lua_Integer i = lua_tointeger(_state, _index);
+                if (i == n)
+                    return 1;
+            }
+            return 0;
+        }
+#endif
 
-                //for execution speed reasons we simply merge BASE's metatable into T's
-                lua_getfield(_state, -1, _wrapper.m_className.cString()); // ... mt
-                stick::Int32 toMetatable = lua_gettop(_state);
-                lua_rawgeti(_state, LUA_REGISTRYINDEX, wc.namespaceIndex); // ... mt nt
-                lua_getfield(_state, -1, wc.wrapper->m_className.cString()); // ... mt nt basemt
-                lua_remove(_state, -2);                                // ... mt basemt
+        using Overloads = stick::DynamicArray<LuanaticFunction>;
 
-                STICK_ASSERT(!lua_isnil(_state, -1));
+        //maximum number of arguments that the overload cache can key on
+        static constexpr stick::Int32 MaxCachedArgumentCount = 8;
+
+        //the shape of an argument is everything that the builtin conversion scores depend on,
+        //i.e. the metatable for userdata and a few value classes for numbers and strings.
+        //Metatable pointers are aligned so they never collide with these small values.
+        enum ArgumentShape : std::uintptr_t
+        {
+            ArgumentShapeNil = 1,
+            ArgumentShapeBoolean,
+            ArgumentShapeInteger,
+            ArgumentShapeNegativeInteger,
+            ArgumentShapeFloat,
+            ArgumentShapeNegativeIntegralFloat,
+            ArgumentShapeString,
+            ArgumentShapeNumericString,
+            ArgumentShapeNegativeIntegralNumericString
+        };
 
-                //iterate over all the key value pairs in the base class meta table
-                for (lua_pushnil(_state); lua_next(_state, -2); lua_pop(_state, 1))
+        //returns false if the argument's score might depend on more than its shape (i.e. tables)
+        inline bool argumentShape(lua_State * _luaState, stick::Int32 _index, std::uintptr_t & _outShape)
+        {
+            switch (lua_type(_luaState, _index))
+            {
+            case LUA_TNIL:
+                _outShape = ArgumentShapeNil;
+                return true;
+            case LUA_TBOOLEAN:
+                _outShape = ArgumentShapeBoolean;
+                return true;
+            case LUA_TNUMBER:
+                //UInt32 scores check the sign of the integer representation
+                if (lua_isinteger(_luaState, _index))
+                    _outShape = lua_tointeger(_luaState, _index) < 0 ? ArgumentShapeNegativeInteger : ArgumentShapeInteger;
+                else
+                    _outShape = lua_tointeger(_luaState, _index) < 0 ? ArgumentShapeNegativeIntegralFloat : ArgumentShapeFloat;
+                return true;
+            case LUA_TSTRING:
+                if (lua_isnumber(_luaState, _index))
+                    _outShape = lua_tointeger(_luaState, _index) < 0 ? ArgumentShapeNegativeIntegralNumericString : ArgumentShapeNumericString;
+                else
+                    _outShape = ArgumentShapeString;
+                return true;
+            case LUA_TUSERDATA:
+                if (lua_getmetatable(_luaState, _index))
                 {
-                    // TODO: use strcmp to avoid copies
-                    if (stick::String(lua_tostring(_state, -2)) == "__bases" ||
-                            //stick::String(lua_tostring(_state, -2)) == "__overloads" ||
-                            stick::String(lua_tostring(_state, -2)) == "__typeID" ||
-                            stick::String(lua_tostring(_state, -2)) == "__index" ||
-                            stick::String(lua_tostring(_state, -2)) == "__newindex" ||
-                            stick::String(lua_tostring(_state, -2)) == "__gc")
-                    {
-                        continue;
-                    }
-                    //check if this is the attributes sub table or another field
-                    else if (stick::String(lua_tostring(_state, -2)) != "__attributes")
-                    {
-                        //check if the key allready exists in the target metatable
-                        lua_pushvalue(_state, -2);         // mt basemt key value key
-                        lua_pushvalue(_state, -1);         // mt basemt key value key key
-                        lua_gettable(_state, toMetatable); // mt basemt key value key tableOrNil
-
-                        //if not, copy the key value pair to T's metatable
-                        if (lua_isnil(_state, -1))
-                        {
-                            lua_pop(_state, 1);        // mt basemt key value key
-                            lua_pushvalue(_state, -2); // mt basemt key value key value
-                            lua_settable(_state, toMetatable); // mt basemt key value
-                        }
-                        else
-                            lua_pop(_state, 2); // mt basemt key value
-                    }
-                    else
-                    {
-                        //copy the attributes
-                        for (lua_pushnil(_state); lua_next(_state, -2); lua_pop(_state, 1))
-                        {
-                            lua_getfield(_state, toMetatable, "__attributes"); // mt basemt key value key value mt.__attributes
-                            lua_pushvalue(_state, -3);                         // mt basemt key value key value mt.__attributes key
-                            lua_pushvalue(_state, -3);                         // mt basemt key value key value mt.__attributes key value
-                            lua_settable(_state, -3);                          // mt basemt key value key value mt.__attributes
-                            lua_pop(_state, 1);                                // mt basemt key value key value
-                        }
-                    }
+                    _outShape = reinterpret_cast<std::uintptr_t>(lua_topointer(_luaState, -1));
+                    lua_pop(_luaState, 1);
+                    return true;
                 }
-
-                lua_pop(_state, 2); //
+                return false;
+            default:
+                return false;
             }
         }
-    }
 
-    namespace detail
-    {
-        template <class U>
-        stick::Int32 DefaultValueTypeConverterImpl < U, typename std::enable_if < std::is_copy_constructible<U>::value>::type >::push(lua_State * _state, const U & _value)
+        //monomorphic inline cache, remembers the overload that was picked for the last argument shapes
+        struct OverloadCache
         {
-            //By default we try pushing this as if it was a registered type,
-            //hoping that it will succeed.
-            detail::LuanaticState * state = detail::luanaticState(_state);
-            STICK_ASSERT(state);
-            luanatic::push(_state, state->m_allocator->create<U>(_value), true);
-            return 1;
-        }
-    }
+            OverloadCache() :
+                argCount(-1)
+            {
 
-    template <class U>
-    stick::Int32 ValueTypeConverter<stick::UniquePtr<U>>::push(lua_State * _state, const stick::UniquePtr<U> & _value)
-    {
-        detail::LuanaticState * state = detail::luanaticState(_state);
-        STICK_ASSERT(state);
-        //damn...this const cast feels hella sketchy let's see if we can come up with a better way to push
-        //unique pointers from value. (I think this might be as good as it gets)
-        luanatic::push(_state, state->m_allocator->create<stick::UniquePtr<U>>(std::move(const_cast<stick::UniquePtr<U>&>(_value))), true);
-        return 1;
-    }
+            }
 
-    template <class U>
-    const stick::SharedPtr<U> & ValueTypeConverter<stick::SharedPtr<U>>::convertAndCheck(lua_State * _state, stick::Int32 _index)
-    {
-        return *convertToTypeAndCheck<stick::SharedPtr<U>>(_state, _index);
-    }
+            void reset()
+            {
+                argCount = -1;
+            }
 
-    template <class U>
-    stick::Int32 ValueTypeConverter<stick::SharedPtr<U>>::push(lua_State * _state, const stick::SharedPtr<U> & _value)
-    {
-        detail::LuanaticState * state = detail::luanaticState(_state);
-        STICK_ASSERT(state);
-        //see comment in uniqueptr function
-        luanatic::push(_state, state->m_allocator->create<stick::SharedPtr<U>>(std::move(const_cast<stick::SharedPtr<U>&>(_value))), true);
-        return 1;
-    }
+            stick::Int32 argCount;
+            stick::Size generation;
+            std::uintptr_t shapes[MaxCachedArgumentCount];
+            stick::Size overloadIndex;
+            stick::Int32 defArgsToPush;
+        };
 
-    template <class T>
-    inline bool isOfType(lua_State * _luaState, stick::Int32 _index, bool _bStrict)
-    {
-        bool ret = false;
-        if (lua_isuserdata(_luaState, _index))
+        struct OverloadSet
         {
-            if (lua_isuserdata(_luaState, _index) &&
-                    lua_getmetatable(_luaState, _index))
+            OverloadSet() :
+                bShapeOnlyScores(true)
             {
-                lua_getfield(_luaState, -1, "__typeID");
-                stick::TypeID tid = (stick::TypeID)lua_touserdata(_luaState, -1);
-                if (tid == stick::TypeInfoT<T>::typeID())
+
+            }
+
+            void addOverload(const LuanaticFunction & _function)
+            {
+                functions.append(_function);
+                bShapeOnlyScores = bShapeOnlyScores && _function.bShapeOnlyScore;
+                cache.reset();
+                rebuildArityBuckets();
+            }
+
+            //buckets the overloads by the number of lua arguments they accept (taking default
+            //arguments into account) so that dispatch only scores plausible candidates.
+            void rebuildArityBuckets()
+            {
+                stick::Size maxArgCount = 0;
+                for (stick::Size i = 0; i < functions.count(); ++i)
                 {
-                    ret = true;
+                    if (functions[i].argCountFunction)
+                        maxArgCount = std::max(maxArgCount, functions[i].argCountFunction());
                 }
 
-                if (!ret && !_bStrict)
+                arityOffsets.clear();
+                arityIndices.clear();
+                variadic.clear();
+                for (stick::Size argCount = 0; argCount <= maxArgCount; ++argCount)
                 {
-                    detail::LuanaticState * glua = detail::luanaticState(_luaState);
-                    STICK_ASSERT(glua != nullptr);
-
-                    ret = detail::checkBases<T>(*glua, tid);
+                    arityOffsets.append(arityIndices.count());
+                    for (stick::Size i = 0; i < functions.count(); ++i)
+                    {
+                        const LuanaticFunction & func = functions[i];
+                        if (!func.argCountFunction)
+                            continue;
+                        stick::Size maxCount = func.argCountFunction();
+                        stick::Size defCount = func.defaultArgs ? func.defaultArgs->argCount() : 0;
+                        if (argCount <= maxCount && argCount + defCount >= maxCount)
+                            arityIndices.append(i);
+                    }
                 }
+                arityOffsets.append(arityIndices.count());
 
-                lua_pop(_luaState, 2);
+                for (stick::Size i = 0; i < functions.count(); ++i)
+                {
+                    if (!functions[i].argCountFunction)
+                        variadic.append(i);
+                }
             }
-        }
 
-        return ret;
-    }
+            Overloads functions;
+            //the overloads accepting n arguments are
+            //arityIndices[arityOffsets[n]] to arityIndices[arityOffsets[n + 1]]
+            stick::DynamicArray<stick::Size> arityOffsets;
+            stick::DynamicArray<stick::Size> arityIndices;
+            //overloads with an unknown argument count, these are scored for every call
+            stick::DynamicArray<stick::Size> variadic;
+            //the cache is only used if the scores of all overloads are a function of the argument shapes
+            bool bShapeOnlyScores;
+            OverloadCache cache;
+        };
 
-    namespace detail
-    {
-        //Note: Lua < 5.3 does not have isinteger function
-#if LUA_VERSION_NUM < 503
-        int lua_isinteger (lua_State * _state, stick::Int32 _index)
+        struct EvaluatedOverload
         {
-            if (lua_type(_state, _index) == LUA_TNUMBER)
+            stick::Size index;
+            stick::Int32 defArgsToPush;
+            stick::Int32 score;
+        };
+
+        inline EvaluatedOverload scoreOverload(lua_State * _luaState, const Overloads & _overloads, stick::Size _index, stick::Int32 _argCount)
+        {
+            const LuanaticFunction & func = _overloads[_index];
+            EvaluatedOverload ret = {_index, 0, 0};
+            ret.score = func.scoreFunction(_luaState, _argCount, func.defaultArgs ? func.defaultArgs->argCount() : 0, &ret.defArgsToPush);
+            return ret;
+        }
+
+        //calls _func for every overload in _set that might accept _argCount arguments
+        template<class F>
+        inline void forEachPlausibleOverload(const OverloadSet & _set, stick::Int32 _argCount, F _func)
+        {
+            if (static_cast<stick::Size>(_argCount) + 1 < _set.arityOffsets.count())
             {
-                lua_Number n = lua_tonumber(_state, _index);
-                lua_Integer i = lua_tointeger(_state, _index);
-                if (i == n)
-                    return 1;
+                for (stick::Size i = _set.arityOffsets[_argCount]; i < _set.arityOffsets[_argCount + 1]; ++i)
+                    _func(_set.arityIndices[i]);
             }
-            return 0;
+            for (stick::Size i = 0; i < _set.variadic.count(); ++i)
+                _func(_set.variadic[i]);
         }
-#endif
 
-        //helpers to generate conversion scores for default lua types and basic c++ value types
-        template<class T>
-        struct LuaTypeScore
+        inline stick::Int32 callOverload(lua_State * _luaState, const LuanaticFunction & _function, stick::Int32 _defArgsToPush)
         {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            //call the function we found, make sure to push the default arguments if any
+            if (_function.defaultArgs && _defArgsToPush > 0)
             {
-                //@TODO: Check if we need to return a different value if a value type
-                // converter exists to avoid ambiguities.
-                //@TODO: HasValueTypeConverter will return true for any DynamicArray
-                //without checking for the type that is requested. There should be
-                //some check to validate that the requested type inside the DynamicArray
-                //can be converted, too.
-                if (HasValueTypeConverter<T>::value)
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
+                _function.defaultArgs->push(_luaState, _defArgsToPush);
             }
-        };
+            return _function.function(_luaState);
+        }
 
-        template<>
-        struct LuaTypeScore<stick::UInt32>
+        //resolves and calls the best overload in _set for the arguments on the stack
+        inline stick::Int32 callOverloadSet(lua_State * _luaState, OverloadSet * _set)
         {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
-            {
-                lua_Integer i = lua_tointeger(_luaState, _index);
-                if (lua_isinteger(_luaState, _index) && i >= 0)
-                    return 0;
-                else if (lua_isnumber(_luaState, _index) && i >= 0)
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
-            }
-        };
+            stick::Int32 argCount = lua_gettop(_luaState);
+            Overloads * overloads = &_set->functions;
+            OverloadCache & cache = _set->cache;
+            stick::Size generation = luanaticState(_luaState)->m_registrationGeneration;
 
-        template<>
-        struct LuaTypeScore<stick::Int32>
-        {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            //compute the argument shapes and check the cache
+            std::uintptr_t shapes[MaxCachedArgumentCount];
+            bool bCacheable = _set->bShapeOnlyScores && argCount <= MaxCachedArgumentCount;
+            for (stick::Int32 i = 0; bCacheable && i < argCount; ++i)
+                bCacheable = argumentShape(_luaState, i + 1, shapes[i]);
+
+            if (bCacheable && cache.argCount == argCount && cache.generation == generation &&
+                    std::memcmp(cache.shapes, shapes, sizeof(std::uintptr_t) * argCount) == 0)
             {
-                if (lua_isinteger(_luaState, _index))
-                    return 0;
-                else if (lua_isnumber(_luaState, _index))
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
+                return callOverload(_luaState, (*overloads)[cache.overloadIndex], cache.defArgsToPush);
             }
-        };
 
-        template<>
-        struct LuaTypeScore<stick::Float32>
-        {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            //find the best scoring overload and count how many share its score
+            EvaluatedOverload best = {0, 0, std::numeric_limits<stick::Int32>::max()};
+            stick::Size idx = 0;
+            forEachPlausibleOverload(*_set, argCount, [&](stick::Size _index)
             {
-                if (lua_type(_luaState, _index) == LUA_TNUMBER)
+                EvaluatedOverload eo = scoreOverload(_luaState, *overloads, _index, argCount);
+                if (eo.score == std::numeric_limits<stick::Int32>::max())
+                    return;
+                if (eo.score == best.score)
                 {
-                    return 0;
+                    ++idx;
                 }
-                else if (lua_isnumber(_luaState, _index))
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
-            }
-        };
+                else if (eo.score < best.score)
+                {
+                    best = eo;
+                    idx = 1;
+                }
+            });
 
-        template<>
-        struct LuaTypeScore<stick::Float64>
-        {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            //NOTE: the candidate strings are pushed onto the lua stack before raising the error
+            //so that the stick::String is destroyed before lua_error longjmps out of here.
+            if (!idx)
             {
-                if (lua_type(_luaState, _index) == LUA_TNUMBER)
                 {
-                    return 0;
+                    stick::String str;
+                    for (stick::Size i = 0; i < overloads->count(); i++)
+                    {
+                        if (i < overloads->count() - 1)
+                            str.append(stick::AppendVariadicFlag(), "   ", (*overloads)[i].signatureStrFunction(), ",\n");
+                        else
+                            str.append(stick::AppendVariadicFlag(), "   ", (*overloads)[i].signatureStrFunction(), "\n");
+                    }
+                    lua_pushstring(_luaState, str.cString());
                 }
-                else if (lua_isnumber(_luaState, _index))
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
+                luaErrorWithStackTrace(_luaState, 1, "\nCould not find candidate for overloaded function, Candidates:\n%s", lua_tostring(_luaState, -1));
             }
-        };
-
-        template<>
-        struct LuaTypeScore<stick::String>
-        {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            else if (idx > 1)
             {
-                if (lua_type(_luaState, _index) == LUA_TSTRING)
                 {
-                    return 0;
+                    //score again to collect the ambiguous candidates for the error message
+                    stick::String str;
+                    forEachPlausibleOverload(*_set, argCount, [&](stick::Size _index)
+                    {
+                        if (scoreOverload(_luaState, *overloads, _index, argCount).score != best.score)
+                            return;
+                        if (--idx)
+                            str.append(stick::AppendVariadicFlag(), "   ", (*overloads)[_index].signatureStrFunction(), ",\n");
+                        else
+                            str.append(stick::AppendVariadicFlag(), "   ", (*overloads)[_index].signatureStrFunction(), "\n");
+                    });
+                    lua_pushstring(_luaState, str.cString());
                 }
-                else if (lua_isstring(_luaState, _index))
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
+                luaErrorWithStackTrace(_luaState, 1, "\nAmbiguous call to overloaded function, Candidates:\n%s", lua_tostring(_luaState, -1));
             }
-        };
-
-        template<>
-        struct LuaTypeScore<const char *>
-        {
-            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            else
             {
-                if (lua_type(_luaState, _index) == LUA_TSTRING)
+                if (bCacheable)
                 {
-                    return 0;
+                    cache.argCount = argCount;
+                    cache.generation = generation;
+                    std::memcpy(cache.shapes, shapes, sizeof(std::uintptr_t) * argCount);
+                    cache.overloadIndex = best.index;
+                    cache.defArgsToPush = best.defArgsToPush;
                 }
-                else if (lua_isstring(_luaState, _index))
-                    return 1;
-                return std::numeric_limits<stick::Int32>::max();
+                return callOverload(_luaState, (*overloads)[best.index], best.defArgsToPush);
             }
-        };
-    }
 
-    template <class T>
-    inline stick::Int32 conversionScore(lua_State * _luaState, stick::Int32 _index)
-    {
-        using RT = typename detail::RawType<T>::Type;
-        if (!lua_isuserdata(_luaState, _index))
-        {
-            return detail::LuaTypeScore<RT>::score(_luaState, _index);
+            return 0;
         }
-        else if (isOfType<RT>(_luaState, _index, true))
+
+        inline stick::Int32 callOverloadedFunction(lua_State * _luaState)
         {
-            // return 0;
-            return std::is_pointer<T>::value ? 0 : 1;
+            STICK_ASSERT(lua_isuserdata(_luaState, lua_upvalueindex(1)));
+            return callOverloadSet(_luaState, (OverloadSet *)lua_touserdata(_luaState, lua_upvalueindex(1)));
         }
-        else
+
+        //__call of a class table. The upvalue is either the plain constructor function or
+        //the OverloadSet of the constructors, both are invoked in place without a nested lua_call.
+        inline stick::Int32 callConstructorNice(lua_State * _luaState)
         {
-            detail::UserData * pud = static_cast<detail::UserData *>(lua_touserdata(_luaState, _index));
-            detail::LuanaticState * glua = detail::luanaticState(_luaState);
-            STICK_ASSERT(glua != nullptr);
-            auto cc = detail::findCastFunctionImpl(*glua, *pud, stick::TypeInfoT<RT>::typeID(), 2).castCount;
-            if (cc != -1)
-                return cc;
-            else return std::numeric_limits<stick::Int32>::max();
+            //for nice constructor we need to pop the first stack item
+            lua_remove(_luaState, 1);
+
+            lua_CFunction constructor = lua_tocfunction(_luaState, lua_upvalueindex(1));
+            if (constructor)
+                return constructor(_luaState);
+
+            STICK_ASSERT(lua_isuserdata(_luaState, lua_upvalueindex(1)));
+            return callOverloadSet(_luaState, (OverloadSet *)lua_touserdata(_luaState, lua_upvalueindex(1)));
         }
-        return std::numeric_limits<stick::Int32>::max();
-    }
 
-    template <class T>
-    inline T * convertToType(lua_State * _luaState, stick::Int32 _index, bool _bStrict)
-    {
-        if (isOfType<T>(_luaState, _index, _bStrict))
+        void registerFunctions(lua_State * _luaState, stick::Int32 _targetTableIndex,
+                               const ClassWrapperBase::NamedLuaFunctionArray & _functions,
+                               const stick::String & _nameReplace = "",
+                               bool _bNiceConstructor = false)
         {
-            detail::UserData * pud = static_cast<detail::UserData *>(lua_touserdata(_luaState, _index));
-            if (pud->m_typeID == stick::TypeInfoT<T>::typeID())
+            STICK_ASSERT(lua_istable(_luaState, _targetTableIndex));
+            STICK_ASSERT(lua_istable(_luaState, -1));
+            auto it = _functions.begin();
+            const char * name;
+
+            //if there is no overload table in target scope, create it
+            lua_getfield(_luaState, _targetTableIndex, "__overloads");
+            if (lua_isnil(_luaState, -1))
             {
-                return static_cast<T *>(pud->m_data);
+                lua_newtable(_luaState); // ... CT mT {}
+                lua_setfield(_luaState, _targetTableIndex, "__overloads"); // ... CT mT
             }
-            if (!_bStrict)
+            lua_pop(_luaState, 1);
+
+
+            LuanaticState * lstate = luanaticState(_luaState);
+            STICK_ASSERT(lstate);
+
+            for (; it != _functions.end(); ++it)
             {
-                detail::LuanaticState * glua = detail::luanaticState(_luaState);
-                STICK_ASSERT(glua != nullptr);
+                name = _nameReplace.length() ? _nameReplace.cString()
+                       : (*it).name.cString();
+                lua_getfield(_luaState, -1, name); // ... CT mT mT[name]
 
-                auto result = detail::findCastFunction(*glua, *pud, stick::TypeInfoT<T>::typeID());
-                if (result.castCount != -1)
+                //the luastate owns the default args
+                if ((*it).function.defaultArgs)
+                    lstate->m_defaultArgStorage.append(stick::UniquePtr<DefaultArgsBase>((*it).function.defaultArgs, stick::defaultAllocator()));
+
+                if (lua_isnil(_luaState, -1))
                 {
-                    return static_cast<T *>(result.userData.m_data);
+                    //copy the function into the overloaded table (this is kinda not super memory efficient)
+                    //if you don't use overloaded functions, but we need to store it somewhere, better ideas?
+                    //@TODO: Better ideas that don't use this extra memory and don't compromise speed?
+                    lua_getfield(_luaState, _targetTableIndex, "__overloads"); // ... CT mT nil __overloads
+                    pushUnregisteredType(_luaState, OverloadSet()); // ... CT mT nil __overloads ola
+                    lua_pushvalue(_luaState, -1); // ... CT mT nil __overloads ola ola
+                    OverloadSet * overloads = (OverloadSet *)lua_touserdata(_luaState, -1);
+                    overloads->addOverload((*it).function);
+
+                    lua_setfield(_luaState, -3, name); // ... CT mT nil __overloads ola
+
+                    if (!(*it).function.defaultArgs)
+                    {
+                        lua_pop(_luaState, 2); // ... CT mT nil
+                        lua_pushstring(_luaState, name); // ... CT mT nil name
+                        lua_pushcfunction(_luaState, (*it).function.function); // ... CT mT nil name func
+                        if (_bNiceConstructor)
+                        {
+                            lua_pushcclosure(_luaState, callConstructorNice, 1);
+                        }
+                        lua_settable(_luaState, -4); // ... CT mT nil
+                        lua_pop(_luaState, 1); // ... CT mT
+                    }
+                    else
+                    {
+                        lua_pushcclosure(_luaState, _bNiceConstructor ? callConstructorNice : callOverloadedFunction, 1); // ... CT mT nil __overloads closure
+                        lua_setfield(_luaState, -4, name); // ... CT mT __overloads nil
+                        lua_pop(_luaState, 2); // ... CT mT g
+                    }
+                }
+                else
+                {
+                    lua_getfield(_luaState, _targetTableIndex, "__overloads"); // ... CT mT __overloads
+                    lua_getfield(_luaState, -1, name); // ... CT mT __overloads namefield
+                    STICK_ASSERT(lua_isuserdata(_luaState, -1));
+                    OverloadSet * overloads = (OverloadSet *)lua_touserdata(_luaState, -1);
+                    overloads->addOverload((*it).function);
+
+                    //push the c closure and set the overloaded
+                    lua_pushcclosure(_luaState, _bNiceConstructor ? callConstructorNice : callOverloadedFunction, 1); // ... CT mT __overloads namefield closure
+                    lua_setfield(_luaState, -4, name); // ... CT mT __overloads namefield
+                    lua_pop(_luaState, 2); // ... CT mT
                 }
             }
         }
 
-        return nullptr;
-    }
+        template <class T>
+        inline stick::Int32 newIndex(lua_State * _luaState);
 
-    template <class T>
-    inline T * convertToTypeAndCheck(lua_State * _luaState, stick::Int32 _index, bool _bStrict)
-    {
-        T * ret = convertToType<T>(_luaState, _index, _bStrict);
-        if (!ret)
-        {
-            detail::LuanaticState * glua = detail::luanaticState(_luaState);
-            STICK_ASSERT(glua != nullptr);
+        template <class T>
+        inline stick::Int32 index(lua_State * _luaState);
 
-            auto it = glua->m_typeIDClassMap.find(stick::TypeInfoT<T>::typeID());
-            if (it != glua->m_typeIDClassMap.end())
-            {
-                detail::luaErrorWithStackTrace(_luaState, _index, "%s expected, got %s",
-                                               detail::demangleTypeName(glua->m_typeIDClassMap[stick::TypeInfoT<T>::typeID()].wrapper->m_className.cString()).cString(),
-                                               luaL_typename(_luaState, _index));
-            }
-            else
-            {
-                detail::luaErrorWithStackTrace(_luaState, _index, "Different unregistered type expected, got %s", luaL_typename(_luaState, _index));
-            }
-        }
+        template <class T>
+        stick::Int32 destruct(lua_State * _luaState);
 
-        return ret;
-    }
+        template <class T>
+        inline stick::Int32 destructUnregistered(lua_State * _luaState);
 
-    namespace detail
-    {
-        template<class T>
-        struct PickValueTypeConverter
+
+        //attributes are stored as these in the accessor table of a class
+        struct AttributeAccessor
         {
-            using Converter = typename std::conditional<HasValueTypeConverter<T>::value, ValueTypeConverter<T>, DefaultValueTypeConverter<T>>::type;
+            lua_CFunction function;
         };
-    }
 
-    template <class T>
-    inline T convertToValueTypeAndCheck(lua_State * _luaState, stick::Int32 _index)
-    {
-        // check if we can simply make a copy
-        // @TODO: Provide a way to skip this (i.e. ValueTypeConverter allready does this step)
-        T * other = convertToType<T>(_luaState, _index);
-        if (other)
+        //returns the accessor if the value at _index is an AttributeAccessor, the only
+        //userdata in the accessor table without a metatable.
+        inline AttributeAccessor * toAttributeAccessor(lua_State * _state, stick::Int32 _index)
         {
-            return *other;
+            if (lua_type(_state, _index) != LUA_TUSERDATA)
+                return nullptr;
+            if (lua_getmetatable(_state, _index))
+            {
+                lua_pop(_state, 1);
+                return nullptr;
+            }
+            return static_cast<AttributeAccessor *>(lua_touserdata(_state, _index));
         }
 
-        // check if there is a value converted implemented
-        return detail::PickValueTypeConverter<T>::Converter::convertAndCheck(_luaState, _index);
-    }
-
-    template <class T, class WT>
-    inline bool pushWrapped(lua_State * _luaState, const WT * _obj, bool _bLuaOwnsObject)
-    {
-        if (_obj)
+        //pushes a table that maps every attribute name of the (merged) class table at _classTable
+        //to an AttributeAccessor, so that index and newIndex can call the accessor in place.
+        //Returns true if the class has attributes.
+        inline bool pushAccessorTable(lua_State * _state, stick::Int32 _classTable)
         {
-            if (_bLuaOwnsObject)
+            bool bHasAttributes = false;
+            lua_newtable(_state); // ... accessors
+            lua_getfield(_state, _classTable, "__attributes"); // ... accessors __attributes
+            for (lua_pushnil(_state); lua_next(_state, -2); lua_pop(_state, 1))
             {
-                lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY); // glua
-                lua_getfield(_luaState, -1, "weakTable");                 // glua glua.weakTable
-                lua_remove(_luaState, -2);                                // glua.weakTable
-                STICK_ASSERT(lua_istable(_luaState, -1));
+                //skips the __overloads table that registerFunctions adds
+                if (!lua_iscfunction(_state, -1))
+                    continue;
 
-                detail::ObjectIdentifier<WT>::identify(_luaState, _obj);
-                STICK_ASSERT(lua_type(_luaState, -1) == LUA_TLIGHTUSERDATA);
+                lua_pushvalue(_state, -2); // ... accessors __attributes key func key
+                AttributeAccessor * accessor = static_cast<AttributeAccessor *>(lua_newuserdata(_state, sizeof(AttributeAccessor)));
+                accessor->function = lua_tocfunction(_state, -3);
+                lua_rawset(_state, -6);    // ... accessors __attributes key func
+                bHasAttributes = true;
+            }
+            lua_pop(_state, 1); // ... accessors
 
-                //check if we find the object in the weaktable
-                lua_pushvalue(_luaState, -1); // glua.weakTable id id
-                lua_gettable(_luaState, -3);  // glua.weakTable id objOrNil
+            return bHasAttributes;
+        }
 
-                if (lua_isnil(_luaState, -1))
-                {
-                    lua_pop(_luaState, 1); // glua.weakTable id
-                    void * ptr = lua_newuserdata(_luaState, sizeof(detail::UserData));
-                    detail::UserData * userData = static_cast<detail::UserData *>(ptr); // glua.weakTable id ud
-                    userData->m_data = (void *)_obj;
-                    userData->m_typeID = stick::TypeInfoT<WT>::typeID();
-                    userData->m_bOwnedByLua = _bLuaOwnsObject;
-                    detail::LuanaticState * glua = detail::luanaticState(_luaState);
-                    STICK_ASSERT(glua != nullptr);
+        template<bool bHasDestructor>
+        struct DestructorRegistration;
 
-                    auto it = glua->m_typeIDClassMap.find(stick::TypeInfoT<T>::typeID());
-                    if (it == glua->m_typeIDClassMap.end())
-                    {
-                        luaL_error(_luaState, "Can't push unregistered type to Lua!");
-                        return false;
-                    }
+        template<>
+        struct DestructorRegistration<false>
+        {
+            template<class T>
+            static void registerDestructor(lua_State * _state, stick::Int32 _classTableIndex)
+            {
 
-                    lua_rawgeti(_luaState, LUA_REGISTRYINDEX, (*it).value.namespaceIndex);
-                    lua_getfield(_luaState, -1, (*it).value.wrapper->m_className.cString()); // glua.weakTable id ud namespace mt
-                    lua_remove(_luaState, -2); // glua.weakTable id ud mt
+            }
+        };
 
-                    lua_setmetatable(_luaState, -2); // glua.weakTable id ud
+        template<>
+        struct DestructorRegistration<true>
+        {
+            template<class T>
+            static void registerDestructor(lua_State * _state, stick::Int32 _classTableIndex)
+            {
+                lua_pushliteral(_state, "__gc");                // ... CT mT __gc
+                lua_pushcfunction(_state, destruct<T>); // ... CT mT  __gc gfunc
+                lua_settable(_state, _classTableIndex);               // ... CT mT
+            }
+        };
 
-                    lua_pushvalue(_luaState, -1); // glua.weakTable id ud ud
-                    lua_insert(_luaState, -4);    // ud glua.weakTable id ud
-                    lua_settable(_luaState, -3);  // ud glua.weakTable
-                    lua_pop(_luaState, 1);        // ud
-                }
-                else
-                {
-                    // if this type is not found in the inheritance chain,
-                    // we can assume, that the currently pushed type sits higher in the inheritance
-                    // chain, so we therefore update the type id associated with this instance.
-                    //@TODO: More sanity checks!!!!!11111
-                    if (std::is_polymorphic<T>() && !isOfType<WT>(_luaState, -1, false))
-                    {
-                        // update the type id
-                        detail::UserData * userData = static_cast<detail::UserData *>(lua_touserdata(_luaState, -1));
-                        userData->m_typeID = stick::TypeInfoT<WT>::typeID();
-                        // update the metatable
-                        detail::LuanaticState * glua = detail::luanaticState(_luaState);
-                        STICK_ASSERT(glua != nullptr);
-                        auto it = glua->m_typeIDClassMap.find(stick::TypeInfoT<T>::typeID());
-                        if (it == glua->m_typeIDClassMap.end())
-                        {
-                            luaL_error(_luaState, "Can't push unregistered type to Lua!");
-                        }
-                        lua_rawgeti(_luaState, LUA_REGISTRYINDEX, (*it).value.namespaceIndex);
-                        lua_getfield(_luaState, -1, (*it).value.wrapper->m_className.cString()); // glua.weakTable id ud namespace mt
-                        lua_remove(_luaState, -2); // glua.weakTable id ud mt
-                        lua_setmetatable(_luaState, -2); // glua.weakTable id ud
-                    }
+        template <class CW, bool bHasDestructor = true>
+        inline void registerClass(lua_State * _state, const CW & _wrapper)
+        {
+            using ClassType = typename CW::ClassType;
 
-                    //and return the existing user data associated with this instance
-                    lua_replace(_luaState, -3); // ud id
-                    lua_pop(_luaState, 1);      // ud
-                    return true;
+            //NOTE: Call this function with the namespace table that you want to
+            //register the class to on top of the stack.
+
+            LuanaticState * state = luanaticState(_state);
+            STICK_ASSERT(state != nullptr);
+            state->m_registrationGeneration = LuanaticState::nextRegistrationGeneration();
+
+            ClassWrapperUniquePtr cl = stick::makeUnique<CW>(*state->m_allocator, _wrapper);
+            ClassWrapperBase * rep = cl.get();
+
+            //make sure all the bases are registered
+            auto it = _wrapper.m_bases.begin();
+            for (; it != _wrapper.m_bases.end(); ++it)
+            {
+                if (!findClassIndex(*state, *it))
+                {
+                    luaL_error(_state, "attempting to extend a type that has not been registered");
                 }
             }
+
+            //cl->m_bases = bases;
+            stick::TypeID myTypeID = cl->m_typeID;
+            lua_pushvalue(_state, -1);
+            LuanaticState::WrappedClass wrapped{};
+            wrapped.wrapper = std::move(cl);
+            wrapped.namespaceIndex = luaL_ref(_state, LUA_REGISTRYINDEX);
+            wrapped.metatableRef = LUA_NOREF;
+            wrapped.borrowedCacheRef = LUA_NOREF;
+            if (_wrapper.m_bCacheBorrowed)
+            {
+                lua_newtable(_state);                  // ... cache
+                lua_newtable(_state);                  // ... cache {}
+                lua_pushliteral(_state, "v");          // ... cache {} "v"
+                lua_setfield(_state, -2, "__mode");    // ... cache {}
+                lua_setmetatable(_state, -2);          // ... cache
+                wrapped.borrowedCacheRef = luaL_ref(_state, LUA_REGISTRYINDEX); // ...
+            }
+
+            //assign the dense class index, registering a class again replaces it
+            stick::UInt32 classIndex = findClassIndex(*state, myTypeID);
+            if (classIndex)
+            {
+                luaL_unref(_state, LUA_REGISTRYINDEX, classAt(*state, classIndex).namespaceIndex);
+                luaL_unref(_state, LUA_REGISTRYINDEX, classAt(*state, classIndex).metatableRef);
+                luaL_unref(_state, LUA_REGISTRYINDEX, classAt(*state, classIndex).borrowedCacheRef);
+                //live objects of the previous registration still return their slots to the pool
+                wrapped.pool = classAt(*state, classIndex).pool;
+                classAt(*state, classIndex) = std::move(wrapped);
+            }
             else
             {
-                detail::LuanaticState * glua = detail::luanaticState(_luaState);
-                STICK_ASSERT(glua != nullptr);
+                state->m_classes.append(std::move(wrapped));
+                classIndex = static_cast<stick::UInt32>(state->m_classes.count());
+                state->m_typeIDClassIndexMap[myTypeID] = classIndex;
+            }
+            if (_wrapper.m_storageMode == StorageMode::Pooled && !classAt(*state, classIndex).pool)
+            {
+                state->m_pools.append(stick::makeUnique<ObjectPool>(*state->m_allocator, *state->m_allocator,
+                                      sizeof(ClassType), alignof(ClassType), _wrapper.m_poolSlabSize));
+                classAt(*state, classIndex).pool = state->m_pools.last().get();
+            }
+            buildCastTable(*state, classAt(*state, classIndex));
 
-                void * ptr = lua_newuserdata(_luaState, sizeof(detail::UserData));
-                detail::UserData * userData = static_cast<detail::UserData *>(ptr); // ud
-                userData->m_data = (void *)_obj;
-                userData->m_typeID = stick::TypeInfoT<WT>::typeID();
-                userData->m_bOwnedByLua = false;
+            //the class table
+            lua_newtable(_state); // ... CT
+            stick::Int32 classTable = lua_gettop(_state);
+            lua_pushstring(_state, _wrapper.m_className.cString()); // ... CT "className"
+            lua_pushvalue(_state, classTable);                      // ... CT "className" CT
+            lua_settable(_state, -4);                               // ... CT
+
+            //add a metatable to the class table with a __call metamethod to allow nice constructors such as MyClass()
+            //instead of MyClass.new()
+            lua_newtable(_state); // ... CT {}
+            stick::Int32 classMetaTable = lua_gettop(_state);
+            registerFunctions(_state, classMetaTable, _wrapper.m_constructors, "__call", true);
+            lua_setmetatable(_state, classTable); // ... CT
+
+            //register static functions in class table
+            registerFunctions(_state, classTable, _wrapper.m_statics);
+
+            lua_pushliteral(_state, "__typeID");            // ... CT __typeID
+            lua_pushlightuserdata(_state, myTypeID);        // ... CT __typeID id
+            lua_settable(_state, classTable);               // ... CT
+
+            lua_pushinteger(_state, classIndex);            // ... CT idx
+            lua_setfield(_state, classTable, "__classIndex"); // ... CT
+
+            //keep a reference to the class table for identity checks
+            lua_pushvalue(_state, classTable);              // ... CT CT
+            classAt(*state, classIndex).metatable = lua_topointer(_state, classTable);
+            classAt(*state, classIndex).metatableRef = luaL_ref(_state, LUA_REGISTRYINDEX); // ... CT
+
+            //__index and __newindex are set once the bases are merged, see below
+            //lua_pushliteral(_state, "__overloads");
+            //lua_newtable(_state);
+            //lua_settable(_state, classTable); // ... CT mT
+            lua_pushliteral(_state, "__className");
+            lua_pushstring(_state, _wrapper.m_className.cString());
+            lua_settable(_state, classTable); // ... CT mT
+
+            //register member functions
+            registerFunctions(_state, classTable, _wrapper.m_members);
+
+            //destructor
+            using DesReg = DestructorRegistration<bHasDestructor>;
+            DesReg::template registerDestructor<ClassType>(_state, classTable);
 
-                auto it = glua->m_typeIDClassMap.find(stick::TypeInfoT<T>::typeID());
-                if (it == glua->m_typeIDClassMap.end())
+            lua_newtable(_state); // ... CT mT {}
+            //register attributes if provided
+            registerFunctions(_state, lua_gettop(_state), _wrapper.m_attributes); //... CT mT
+            lua_setfield(_state, -2, "__attributes");                       // ... CT mT
+
+            //create a table that holds the base classes
+            lua_newtable(_state);                // ... CT {}
+            lua_setfield(_state, -2, "__bases"); // ... CT
+
+            lua_pop(_state, 1); // ...
+
+            //now merge all the base metatables with this metatable for access speed
+            auto sit = rep->m_bases.begin();
+
+            stick::Size baseID = 1;
+            for (; sit != rep->m_bases.end(); ++sit)
+            {
+                const LuanaticState::WrappedClass & wc = *findClass(*state, *sit);
+                //insert BASE class table in the __bases table of T's ClassTable
+                lua_getfield(_state, -1, _wrapper.m_className.cString()); // ... CT
+                lua_getfield(_state, -1, "__bases");                    // ... CT __bases
+                stick::Int32 basesCount = baseID++;
+                lua_pushinteger(_state, basesCount);                   // ... CT __bases i
+                lua_rawgeti(_state, LUA_REGISTRYINDEX, wc.metatableRef); // ... CT __bases i CB
+                lua_settable(_state, -3);                              // ... CT __bases
+                lua_pop(_state, 2);                                    // ...
+
+                //for execution speed reasons we simply merge BASE's metatable into T's
+                lua_getfield(_state, -1, _wrapper.m_className.cString()); // ... mt
+                stick::Int32 toMetatable = lua_gettop(_state);
+                lua_rawgeti(_state, LUA_REGISTRYINDEX, wc.metatableRef); // ... mt basemt
+
+                STICK_ASSERT(!lua_isnil(_state, -1));
+
+                //iterate over all the key value pairs in the base class meta table
+                for (lua_pushnil(_state); lua_next(_state, -2); lua_pop(_state, 1))
                 {
-                    luaL_error(_luaState, "Can't push unregistered type to Lua!");
+                    // TODO: use strcmp to avoid copies
+                    if (stick::String(lua_tostring(_state, -2)) == "__bases" ||
+                            //stick::String(lua_tostring(_state, -2)) == "__overloads" ||
+                            stick::String(lua_tostring(_state, -2)) == "__typeID" ||
+                            stick::String(lua_tostring(_state, -2)) == "__classIndex" ||
+                            stick::String(lua_tostring(_state, -2)) == "__accessors" ||
+                            stick::String(lua_tostring(_state, -2)) == "__index" ||
+                            stick::String(lua_tostring(_state, -2)) == "__newindex" ||
+                            stick::String(lua_tostring(_state, -2)) == "__gc")
+                    {
+                        continue;
+                    }
+                    //check if this is the attributes sub table or another field
+                    else if (stick::String(lua_tostring(_state, -2)) != "__attributes")
+                    {
+                        //check if the key allready exists in the target metatable
+                        lua_pushvalue(_state, -2);         // mt basemt key value key
+                        lua_pushvalue(_state, -1);         // mt basemt key value key key
+                        lua_gettable(_state, toMetatable); // mt basemt key value key tableOrNil
+
+                        //if not, copy the key value pair to T's metatable
+                        if (lua_isnil(_state, -1))
+                        {
+                            lua_pop(_state, 1);        // mt basemt key value key
+                            lua_pushvalue(_state, -2); // mt basemt key value key value
+                            lua_settable(_state, toMetatable); // mt basemt key value
+                        }
+                        else
+                            lua_pop(_state, 2); // mt basemt key value
+                    }
+                    else
+                    {
+                        //copy the attributes
+                        for (lua_pushnil(_state); lua_next(_state, -2); lua_pop(_state, 1))
+                        {
+                            lua_getfield(_state, toMetatable, "__attributes"); // mt basemt key value key value mt.__attributes
+                            lua_pushvalue(_state, -3);                         // mt basemt key value key value mt.__attributes key
+                            lua_pushvalue(_state, -3);                         // mt basemt key value key value mt.__attributes key value
+                            lua_settable(_state, -3);                          // mt basemt key value key value mt.__attributes
+                            lua_pop(_state, 1);                                // mt basemt key value key value
+                        }
+                    }
                 }
 
-                lua_rawgeti(_luaState, LUA_REGISTRYINDEX, (*it).value.namespaceIndex);
-                lua_getfield(_luaState, -1, (*it).value.wrapper->m_className.cString()); // ud namespace mt
+                lua_pop(_state, 2); //
+            }
+
+            lua_getfield(_state, -1, _wrapper.m_className.cString()); // ... CT
+            stick::Int32 mergedClassTable = lua_gettop(_state);
+            bool bHasAttributes = pushAccessorTable(_state, mergedClassTable); // ... CT accessors
+            lua_pushvalue(_state, -1);                                         // ... CT accessors accessors
+            lua_setfield(_state, mergedClassTable, "__accessors");             // ... CT accessors
 
-                lua_remove(_luaState, -2); // ud mt
-                lua_setmetatable(_luaState, -2); // ud
+            //without attributes the members can be resolved straight from the class table without
+            //entering C. newIndex switches to index<T> once an instance gets dynamic fields.
+            if (bHasAttributes)
+            {
+                lua_pushvalue(_state, -1);                        // ... CT accessors accessors
+                lua_pushvalue(_state, mergedClassTable);          // ... CT accessors accessors CT
+                lua_pushcclosure(_state, index<ClassType>, 2);    // ... CT accessors ifunc
             }
+            else
+                lua_pushvalue(_state, mergedClassTable);          // ... CT accessors CT
+            lua_setfield(_state, mergedClassTable, "__index");    // ... CT accessors
+            lua_pushcclosure(_state, newIndex<ClassType>, 1);     // ... CT nifunc
+            lua_setfield(_state, mergedClassTable, "__newindex"); // ... CT
+            lua_pop(_state, 1); // ...
         }
-        else
-            lua_pushnil(_luaState);
+    }
 
-        return false;
+    namespace detail
+    {
+        template <class U>
+        stick::Int32 DefaultValueTypeConverterImpl < U, typename std::enable_if < std::is_copy_constructible<U>::value>::type >::push(lua_State * _state, const U & _value)
+        {
+            //By default we try pushing this as if it was a registered type,
+            //hoping that it will succeed.
+            pushNew<U>(_state, _value);
+            return 1;
+        }
     }
 
-    template <class T>
-    inline bool push(lua_State * _luaState, const T * _obj, bool _bLuaOwnsObject)
+    template <class U>
+    stick::Int32 ValueTypeConverter<stick::UniquePtr<U>>::push(lua_State * _state, const stick::UniquePtr<U> & _value)
     {
-        return pushWrapped<T>(_luaState, _obj, _bLuaOwnsObject);
+        //damn...this const cast feels hella sketchy let's see if we can come up with a better way to push
+        //unique pointers from value. (I think this might be as good as it gets)
+        detail::pushNew<stick::UniquePtr<U>>(_state, std::move(const_cast<stick::UniquePtr<U>&>(_value)));
+        return 1;
     }
 
-    template <class T>
-    inline stick::Int32 pushValueType(lua_State * _luaState, const T & _value)
+    template <class U>
+    const stick::SharedPtr<U> & ValueTypeConverter<stick::SharedPtr<U>>::convertAndCheck(lua_State * _state, stick::Int32 _index)
     {
-        return detail::PickValueTypeConverter<T>::Converter::push(_luaState, _value);
+        return *convertToTypeAndCheck<stick::SharedPtr<U>>(_state, _index);
     }
 
-    template <class T, class...Args>
-    inline void constructUnregisteredType(lua_State * _luaState, Args ... _args)
+    template <class U>
+    stick::Int32 ValueTypeConverter<stick::SharedPtr<U>>::push(lua_State * _state, const stick::SharedPtr<U> & _value)
     {
-        void * ud = lua_newuserdata(_luaState, sizeof(T));
-        lua_newtable(_luaState);
-        lua_pushcfunction(_luaState, &detail::destructUnregistered<T>);
-        lua_setfield(_luaState, -2, "__gc");
-        lua_setmetatable(_luaState, -2);
-        new (ud) T(std::forward<Args>(_args)...);
+        //see comment in uniqueptr function
+        detail::pushNew<stick::SharedPtr<U>>(_state, std::move(const_cast<stick::SharedPtr<U>&>(_value)));
+        return 1;
     }
 
-    template <class T>
-    inline void pushUnregisteredType(lua_State * _luaState, const T & _value)
-    {
-        void * ud = lua_newuserdata(_luaState, sizeof(T));
-        lua_newtable(_luaState);
-        lua_pushcfunction(_luaState, &detail::destructUnregistered<T>);
-        lua_setfield(_luaState, -2, "__gc");
-        lua_setmetatable(_luaState, -2);
-        new (ud) T(_value);
-    }
+    template <class T>
+    inline bool isOfType(lua_State * _luaState, stick::Int32 _index, bool _bStrict)
+    {
+        bool ret = false;
+        if (lua_isuserdata(_luaState, _index))
+        {
+            detail::LuanaticState * glua = detail::luanaticState(_luaState);
+            STICK_ASSERT(glua != nullptr);
+
+            stick::UInt32 classIndex = detail::identifyUserData(_luaState, _index, *glua);
+            if (classIndex)
+            {
+                if (detail::classAt(*glua, classIndex).wrapper->m_typeID == stick::TypeInfoT<T>::typeID())
+                    return true;
+                return !_bStrict && detail::castDepth(*glua, classIndex, stick::TypeInfoT<T>::typeID()) != -1;
+            }
+
+            if (lua_isuserdata(_luaState, _index) &&
+                    lua_getmetatable(_luaState, _index))
+            {
+                lua_getfield(_luaState, -1, "__typeID");
+                stick::TypeID tid = (stick::TypeID)lua_touserdata(_luaState, -1);
+                if (tid == stick::TypeInfoT<T>::typeID())
+                {
+                    ret = true;
+                }
+
+                if (!ret && !_bStrict && tid)
+                {
+                    classIndex = detail::findClassIndex(*glua, tid);
+                    stick::UInt32 targetIndex = detail::classIndexOf<T>(*glua);
+                    if (classIndex && targetIndex)
+                        ret = detail::hasAncestor(*glua, classIndex, targetIndex);
+                    else
+                        ret = detail::castDepth(*glua, classIndex, stick::TypeInfoT<T>::typeID()) != -1;
+                }
+
+                lua_pop(_luaState, 2);
+            }
+        }
+
+        return ret;
+    }
+
+    namespace detail
+    {
+        //Note: Lua < 5.3 does not have isinteger function
+        //helpers to generate conversion scores for default lua types and basic c++ value types
+        template<class T>
+        struct LuaTypeScore
+        {
+            //the scores only depend on what argumentShape captures, see HasShapeOnlyScore
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                //@TODO: Check if we need to return a different value if a value type
+                // converter exists to avoid ambiguities.
+                //@TODO: HasValueTypeConverter will return true for any DynamicArray
+                //without checking for the type that is requested. There should be
+                //some check to validate that the requested type inside the DynamicArray
+                //can be converted, too.
+                if (HasValueTypeConverter<T>::value)
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<>
+        struct LuaTypeScore<stick::UInt32>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                lua_Integer i = lua_tointeger(_luaState, _index);
+                if (lua_isinteger(_luaState, _index) && i >= 0)
+                    return 0;
+                else if (lua_isnumber(_luaState, _index) && i >= 0)
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<>
+        struct LuaTypeScore<stick::Int32>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                if (lua_isinteger(_luaState, _index))
+                    return 0;
+                else if (lua_isnumber(_luaState, _index))
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<>
+        struct LuaTypeScore<stick::Float32>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                if (lua_type(_luaState, _index) == LUA_TNUMBER)
+                {
+                    return 0;
+                }
+                else if (lua_isnumber(_luaState, _index))
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<>
+        struct LuaTypeScore<stick::Float64>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                if (lua_type(_luaState, _index) == LUA_TNUMBER)
+                {
+                    return 0;
+                }
+                else if (lua_isnumber(_luaState, _index))
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<>
+        struct LuaTypeScore<stick::String>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                if (lua_type(_luaState, _index) == LUA_TSTRING)
+                {
+                    return 0;
+                }
+                else if (lua_isstring(_luaState, _index))
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<>
+        struct LuaTypeScore<StringView> : public LuaTypeScore<stick::String> {};
+
+        template<>
+        struct LuaTypeScore<const char *>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                if (lua_type(_luaState, _index) == LUA_TSTRING)
+                {
+                    return 0;
+                }
+                else if (lua_isstring(_luaState, _index))
+                    return 1;
+                return std::numeric_limits<stick::Int32>::max();
+            }
+        };
+    }
+
+    namespace detail
+    {
+        //true if the score of T is a function of the argument shape (see argumentShape), which is
+        //the case for the builtin LuaTypeScores. User specializations can declare ShapeOnly, too,
+        //otherwise functions taking T are never served from the OverloadCache.
+        template<class T>
+        class HasShapeOnlyScore
+        {
+            template <class U, class = typename LuaTypeScore<typename RawType<U>::Type>::ShapeOnly>
+            static std::true_type check(int);
+
+            template <class>
+            static std::false_type check(...);
+
+        public:
+
+            static constexpr bool value = decltype(check<T>(0))::value;
+        };
+
+        template<bool...B>
+        struct AllOf : std::true_type {};
+
+        template<bool Head, bool...Tail>
+        struct AllOf<Head, Tail...> : std::integral_constant<bool, Head && AllOf<Tail...>::value> {};
+    }
+
+    template <class T>
+    inline stick::Int32 conversionScore(lua_State * _luaState, stick::Int32 _index)
+    {
+        using RT = typename detail::RawType<T>::Type;
+        if (!lua_isuserdata(_luaState, _index))
+        {
+            return detail::LuaTypeScore<RT>::score(_luaState, _index);
+        }
+
+        detail::LuanaticState * glua = detail::luanaticState(_luaState);
+        STICK_ASSERT(glua != nullptr);
+        stick::UInt32 classIndex = detail::identifyUserData(_luaState, _index, *glua);
+        if (classIndex)
+        {
+            if (detail::classAt(*glua, classIndex).wrapper->m_typeID == stick::TypeInfoT<RT>::typeID())
+                return std::is_pointer<T>::value ? 0 : 1;
+            auto depth = detail::castDepth(*glua, classIndex, stick::TypeInfoT<RT>::typeID());
+            return depth != -1 ? depth + 1 : std::numeric_limits<stick::Int32>::max();
+        }
+        else if (isOfType<RT>(_luaState, _index, true))
+        {
+            // return 0;
+            return std::is_pointer<T>::value ? 0 : 1;
+        }
+        else if (detail::rawLen(_luaState, _index) >= sizeof(detail::UserData))
+        {
+            detail::UserData * pud = static_cast<detail::UserData *>(lua_touserdata(_luaState, _index));
+            auto depth = detail::castDepth(*glua, detail::findClassIndex(*glua, pud->m_typeID), stick::TypeInfoT<RT>::typeID());
+            if (depth != -1)
+                return depth + 1;
+            else return std::numeric_limits<stick::Int32>::max();
+        }
+        return std::numeric_limits<stick::Int32>::max();
+    }
+
+    template <class T>
+    inline T * convertToType(lua_State * _luaState, stick::Int32 _index, bool _bStrict)
+    {
+        if (lua_type(_luaState, _index) != LUA_TUSERDATA)
+            return nullptr;
+
+        detail::LuanaticState * glua = detail::luanaticState(_luaState);
+        STICK_ASSERT(glua != nullptr);
+        stick::UInt32 classIndex = detail::identifyUserData(_luaState, _index, *glua);
+        if (classIndex)
+        {
+            detail::UserData * pud = static_cast<detail::UserData *>(lua_touserdata(_luaState, _index));
+            if (pud->m_typeID == stick::TypeInfoT<T>::typeID())
+                return static_cast<T *>(pud->m_data);
+            if (_bStrict)
+                return nullptr;
+            auto result = detail::findCastFunction(*glua, *pud, stick::TypeInfoT<T>::typeID());
+            return result.castCount != -1 ? static_cast<T *>(result.userData.m_data) : nullptr;
+        }
+
+        if (isOfType<T>(_luaState, _index, _bStrict))
+        {
+            detail::UserData * pud = static_cast<detail::UserData *>(lua_touserdata(_luaState, _index));
+            if (pud->m_typeID == stick::TypeInfoT<T>::typeID())
+            {
+                return static_cast<T *>(pud->m_data);
+            }
+            if (!_bStrict)
+            {
+                detail::LuanaticState * glua = detail::luanaticState(_luaState);
+                STICK_ASSERT(glua != nullptr);
+
+                auto result = detail::findCastFunction(*glua, *pud, stick::TypeInfoT<T>::typeID());
+                if (result.castCount != -1)
+                {
+                    return static_cast<T *>(result.userData.m_data);
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    template <class T>
+    inline T * convertToTypeAndCheck(lua_State * _luaState, stick::Int32 _index, bool _bStrict)
+    {
+        T * ret = convertToType<T>(_luaState, _index, _bStrict);
+        if (!ret)
+        {
+            detail::LuanaticState * glua = detail::luanaticState(_luaState);
+            STICK_ASSERT(glua != nullptr);
+
+            auto wc = detail::findClass(*glua, stick::TypeInfoT<T>::typeID());
+            if (wc)
+            {
+                detail::luaErrorWithStackTrace(_luaState, _index, "%s expected, got %s",
+                                               detail::demangleTypeName(wc->wrapper->m_className.cString()).cString(),
+                                               luaL_typename(_luaState, _index));
+            }
+            else
+            {
+                detail::luaErrorWithStackTrace(_luaState, _index, "Different unregistered type expected, got %s", luaL_typename(_luaState, _index));
+            }
+        }
+
+        return ret;
+    }
+
+    namespace detail
+    {
+        template<class T>
+        struct PickValueTypeConverter
+        {
+            using Converter = typename std::conditional<HasValueTypeConverter<T>::value, ValueTypeConverter<T>, DefaultValueTypeConverter<T>>::type;
+        };
+    }
+
+    template <class T>
+    inline T convertToValueTypeAndCheck(lua_State * _luaState, stick::Int32 _index)
+    {
+        static_assert(!std::is_same<T, StringView>::value,
+                      "StringView can only be a function argument, use stick::String to keep the string");
+
+        // check if we can simply make a copy
+        // @TODO: Provide a way to skip this (i.e. ValueTypeConverter allready does this step)
+        T * other = convertToType<T>(_luaState, _index);
+        if (other)
+        {
+            return *other;
+        }
+
+        // check if there is a value converted implemented
+        return detail::PickValueTypeConverter<T>::Converter::convertAndCheck(_luaState, _index);
+    }
+
+    template <class T, class WT>
+    inline bool pushWrapped(lua_State * _luaState, const WT * _obj, bool _bLuaOwnsObject)
+    {
+        if (_obj)
+        {
+            if (_bLuaOwnsObject)
+            {
+                lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY); // glua
+                lua_getfield(_luaState, -1, "weakTable");                 // glua glua.weakTable
+                lua_remove(_luaState, -2);                                // glua.weakTable
+                STICK_ASSERT(lua_istable(_luaState, -1));
+
+                detail::ObjectIdentifier<WT>::identify(_luaState, _obj);
+                STICK_ASSERT(lua_type(_luaState, -1) == LUA_TLIGHTUSERDATA);
+
+                //check if we find the object in the weaktable
+                lua_pushvalue(_luaState, -1); // glua.weakTable id id
+                lua_gettable(_luaState, -3);  // glua.weakTable id objOrNil
+
+                if (lua_isnil(_luaState, -1))
+                {
+                    lua_pop(_luaState, 1); // glua.weakTable id
+                    void * ptr = lua_newuserdata(_luaState, sizeof(detail::UserData));
+                    detail::UserData * userData = static_cast<detail::UserData *>(ptr); // glua.weakTable id ud
+                    userData->m_data = (void *)_obj;
+                    userData->m_typeID = stick::TypeInfoT<WT>::typeID();
+                    userData->m_bOwnedByLua = _bLuaOwnsObject;
+                    userData->m_storageMode = StorageMode::Allocator;
+                    userData->m_bHasStorage = false;
+                    detail::LuanaticState * glua = detail::luanaticState(_luaState);
+                    STICK_ASSERT(glua != nullptr);
+
+                    stick::UInt32 classIndex = detail::classIndexOf<T>(*glua);
+                    if (!classIndex)
+                    {
+                        luaL_error(_luaState, "Can't push unregistered type to Lua!");
+                        return false;
+                    }
+                    userData->m_classIndex = detail::wrappedTypeClassIndex<T, WT>(*glua, classIndex);
+
+                    const detail::LuanaticState::WrappedClass & wc = detail::classAt(*glua, classIndex);
+                    lua_rawgeti(_luaState, LUA_REGISTRYINDEX, wc.metatableRef); // glua.weakTable id ud mt
+                    lua_setmetatable(_luaState, -2); // glua.weakTable id ud
+
+                    lua_pushvalue(_luaState, -1); // glua.weakTable id ud ud
+                    lua_insert(_luaState, -4);    // ud glua.weakTable id ud
+                    lua_settable(_luaState, -3);  // ud glua.weakTable
+                    lua_pop(_luaState, 1);        // ud
+                }
+                else
+                {
+                    // if this type is not found in the inheritance chain,
+                    // we can assume, that the currently pushed type sits higher in the inheritance
+                    // chain, so we therefore update the type id associated with this instance.
+                    //@TODO: More sanity checks!!!!!11111
+                    if (std::is_polymorphic<T>() && !isOfType<WT>(_luaState, -1, false))
+                    {
+                        // update the type id
+                        detail::UserData * userData = static_cast<detail::UserData *>(lua_touserdata(_luaState, -1));
+                        userData->m_typeID = stick::TypeInfoT<WT>::typeID();
+                        // update the metatable
+                        detail::LuanaticState * glua = detail::luanaticState(_luaState);
+                        STICK_ASSERT(glua != nullptr);
+                        stick::UInt32 classIndex = detail::classIndexOf<T>(*glua);
+                        if (!classIndex)
+                        {
+                            luaL_error(_luaState, "Can't push unregistered type to Lua!");
+                        }
+                        userData->m_classIndex = detail::wrappedTypeClassIndex<T, WT>(*glua, classIndex);
+
+                        const detail::LuanaticState::WrappedClass & wc = detail::classAt(*glua, classIndex);
+                        lua_rawgeti(_luaState, LUA_REGISTRYINDEX, wc.metatableRef); // glua.weakTable id ud mt
+                        lua_setmetatable(_luaState, -2); // glua.weakTable id ud
+                    }
+
+                    //and return the existing user data associated with this instance
+                    lua_replace(_luaState, -3); // ud id
+                    lua_pop(_luaState, 1);      // ud
+                    return true;
+                }
+            }
+            else
+            {
+                detail::LuanaticState * glua = detail::luanaticState(_luaState);
+                STICK_ASSERT(glua != nullptr);
+
+                stick::UInt32 classIndex = detail::classIndexOf<T>(*glua);
+                if (!classIndex)
+                {
+                    luaL_error(_luaState, "Can't push unregistered type to Lua!");
+                }
+                const detail::LuanaticState::WrappedClass & wc = detail::classAt(*glua, classIndex);
+
+                //classes that opted in reuse the userdata of earlier pushes of the same object
+                bool bCached = wc.borrowedCacheRef != LUA_NOREF;
+                if (bCached)
+                {
+                    lua_rawgeti(_luaState, LUA_REGISTRYINDEX, wc.borrowedCacheRef); // cache
+                    detail::ObjectIdentifier<WT>::identify(_luaState, _obj);         // cache id
+                    lua_rawget(_luaState, -2);                                       // cache udOrNil
+                    if (!lua_isnil(_luaState, -1))
+                    {
+                        //the address might have been reused by an object of another type
+                        detail::UserData * cached = static_cast<detail::UserData *>(lua_touserdata(_luaState, -1));
+                        if (cached->m_typeID == stick::TypeInfoT<WT>::typeID())
+                        {
+                            lua_remove(_luaState, -2); // ud
+                            return false;
+                        }
+                    }
+                    lua_pop(_luaState, 1); // cache
+                }
+
+                void * ptr = lua_newuserdata(_luaState, sizeof(detail::UserData));
+                detail::UserData * userData = static_cast<detail::UserData *>(ptr); // ud
+                userData->m_data = (void *)_obj;
+                userData->m_typeID = stick::TypeInfoT<WT>::typeID();
+                userData->m_bOwnedByLua = false;
+                userData->m_storageMode = StorageMode::Allocator;
+                userData->m_bHasStorage = false;
+                userData->m_classIndex = detail::wrappedTypeClassIndex<T, WT>(*glua, classIndex);
+
+                lua_rawgeti(_luaState, LUA_REGISTRYINDEX, wc.metatableRef); // ud mt
+                lua_setmetatable(_luaState, -2); // ud
+
+                if (bCached)
+                {
+                    detail::ObjectIdentifier<WT>::identify(_luaState, _obj); // cache ud id
+                    lua_pushvalue(_luaState, -2); // cache ud id ud
+                    lua_rawset(_luaState, -4);    // cache ud
+                    lua_remove(_luaState, -2);    // ud
+                }
+            }
+        }
+        else
+            lua_pushnil(_luaState);
+
+        return false;
+    }
+
+    template <class T>
+    inline bool push(lua_State * _luaState, const T * _obj, bool _bLuaOwnsObject)
+    {
+        return pushWrapped<T>(_luaState, _obj, _bLuaOwnsObject);
+    }
+
+    template <class T>
+    inline stick::Int32 pushValueType(lua_State * _luaState, const T & _value)
+    {
+        return detail::PickValueTypeConverter<T>::Converter::push(_luaState, _value);
+    }
+
+    template <class T, class...Args>
+    inline void constructUnregisteredType(lua_State * _luaState, Args ... _args)
+    {
+        void * ud = lua_newuserdata(_luaState, sizeof(T));
+        lua_newtable(_luaState);
+        lua_pushcfunction(_luaState, &detail::destructUnregistered<T>);
+        lua_setfield(_luaState, -2, "__gc");
+        lua_setmetatable(_luaState, -2);
+        new (ud) T(std::forward<Args>(_args)...);
+    }
+
+    template <class T>
+    inline void pushUnregisteredType(lua_State * _luaState, const T & _value)
+    {
+        void * ud = lua_newuserdata(_luaState, sizeof(T));
+        lua_newtable(_luaState);
+        lua_pushcfunction(_luaState, &detail::destructUnregistered<T>);
+        lua_setfield(_luaState, -2, "__gc");
+        lua_setmetatable(_luaState, -2);
+        new (ud) T(_value);
+    }
+
+    namespace detail
+    {
+        //layout of a StorageMode::Inline userdata block: UserData header followed by the aligned T
+        template <class T>
+        struct InlineStorage
+        {
+            static constexpr stick::Size padding = alignof(T) > alignof(UserData) ? alignof(T) - 1 : 0;
+            static constexpr stick::Size byteCount = sizeof(UserData) + padding + sizeof(T);
+
+            static void * objectAddress(void * _userData)
+            {
+                std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(_userData) + sizeof(UserData);
+                return reinterpret_cast<void *>((addr + alignof(T) - 1) & ~static_cast<std::uintptr_t>(alignof(T) - 1));
+            }
+        };
+
+        //creates a new lua owned T from _args and pushes it, honoring the StorageMode of T's class.
+        //As the object is brand new, there is no need to look it up in the weak table like pushWrapped does.
+        template <class T, class ... Args>
+        inline void pushNew(lua_State * _luaState, Args && ... _args)
+        {
+            LuanaticState * glua = luanaticState(_luaState);
+            STICK_ASSERT(glua != nullptr);
+
+            stick::UInt32 classIndex = classIndexOf<T>(*glua);
+            if (!classIndex)
+            {
+                luaL_error(_luaState, "Can't push unregistered type to Lua!");
+                return;
+            }
+            const LuanaticState::WrappedClass & wc = classAt(*glua, classIndex);
+            StorageMode mode = wc.wrapper->m_storageMode;
+            bool bInline = mode == StorageMode::Inline;
+
+            //get the metatable and userdata first so that nothing can raise a lua error
+            //between creating the object and making it collectable.
+            lua_rawgeti(_luaState, LUA_REGISTRYINDEX, wc.metatableRef); // mt
+
+            void * ptr = lua_newuserdata(_luaState, bInline ? InlineStorage<T>::byteCount : sizeof(UserData)); // mt ud
+            UserData * userData = static_cast<UserData *>(ptr);
+            if (bInline)
+                userData->m_data = new (InlineStorage<T>::objectAddress(ptr)) T(std::forward<Args>(_args)...);
+            else if (mode == StorageMode::Pooled)
+                userData->m_data = new (wc.pool->allocate()) T(std::forward<Args>(_args)...);
+            else
+                userData->m_data = glua->m_allocator->create<T>(std::forward<Args>(_args)...);
+            userData->m_bOwnedByLua = true;
+            userData->m_typeID = stick::TypeInfoT<T>::typeID();
+            userData->m_classIndex = classIndex;
+            userData->m_storageMode = mode;
+            userData->m_bHasStorage = false;
+
+            lua_insert(_luaState, -2); // ud mt
+            lua_setmetatable(_luaState, -2); // ud
+
+            //allocator owned objects might be pushed by pointer again, so they go into the weak table.
+            //inline objects can only ever be owned by their userdata.
+            if (!bInline)
+            {
+                lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY); // ud glua
+                lua_getfield(_luaState, -1, "weakTable");                 // ud glua glua.weakTable
+                lua_remove(_luaState, -2);                                // ud glua.weakTable
+                ObjectIdentifier<T>::identify(_luaState, static_cast<T *>(userData->m_data)); // ud glua.weakTable id
+                lua_pushvalue(_luaState, -3);  // ud glua.weakTable id ud
+                lua_settable(_luaState, -3);   // ud glua.weakTable
+                lua_pop(_luaState, 1);         // ud
+            }
+        }
+    }
+
+    namespace placeHolders
+    {
+        struct Result {};
+        struct One {};
+        struct Two {};
+        struct Three {};
+        struct Four {};
+        struct Five {};
+        struct Six {};
+        struct Seven {};
+        struct Eight {};
+        struct Nine {};
+        struct Ten {};
+    }
+
+    namespace ph = placeHolders;
+
+    namespace detail
+    {
+        struct NoPolicy {};
+
+        template <class P>
+        struct ApplyPolicyPtr
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, T * _val, const P & _policy)
+            {
+                return _policy.template push<typename RawType<T>::Type>(_luaState, _val);
+            }
+        };
+
+        template <>
+        struct ApplyPolicyPtr<NoPolicy>
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, T * _val, const NoPolicy & _p)
+            {
+                if (!_val)
+                    lua_pushnil(_luaState);
+                else
+                    luanatic::push<typename RawType<T>::Type>(_luaState, _val, false);
+                return 1;
+            }
+        };
+
+        //pushes a temporary (i.e. a by value function result). If it ends up as a new
+        //registered object, it is moved into it instead of copied.
+        template <class T, class Enable = void>
+        struct ValueTypeMover
+        {
+            template<class V>
+            static stick::Int32 push(lua_State * _luaState, V && _value)
+            {
+                return luanatic::pushValueType<T>(_luaState, _value);
+            }
+        };
+
+        template <class T>
+        struct ValueTypeMover < T, typename std::enable_if < !HasValueTypeConverter<T>::value && std::is_move_constructible<T>::value >::type >
+        {
+            template<class V>
+            static stick::Int32 push(lua_State * _luaState, V && _value)
+            {
+                pushNew<T>(_luaState, std::forward<V>(_value));
+                return 1;
+            }
+        };
+
+        template <class P>
+        struct ApplyPolicyValueType
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, const T & _val, const P & _policy)
+            {
+                return _policy.template push<typename RawType<T>::Type>(_luaState, _val);
+            }
+        };
+
+        template <>
+        struct ApplyPolicyValueType<NoPolicy>
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, const T & _val, const NoPolicy & _p)
+            {
+                return luanatic::pushValueType<typename RawType<T>::Type>(_luaState, _val);
+            }
+
+            template < class T, class = typename std::enable_if < !std::is_reference<T>::value >::type >
+            static stick::Int32 apply(lua_State * _luaState, T && _val, const NoPolicy & _p)
+            {
+                return ValueTypeMover<typename RawType<T>::Type>::push(_luaState, std::forward<T>(_val));
+            }
+        };
+
+        //const references are fine for buffers, but a by value result is destroyed right after it
+        //was pushed, which would leave the buffer dangling
+        template <class G>
+        struct ApplyPolicyValueType<ReturnBuffer<G>>
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, const T & _val, const ReturnBuffer<G> & _policy)
+            {
+                return _policy.push(_luaState, _val);
+            }
+
+            template < class T, class = typename std::enable_if < !std::is_reference<T>::value >::type >
+            static stick::Int32 apply(lua_State * _luaState, T && _val, const ReturnBuffer<G> & _policy)
+            {
+                static_assert(!std::is_same<T, T>::value,
+                              "ReturnBuffer can only be used with functions that return a reference or pointer");
+                return 0;
+            }
+        };
+
+
+        template <class T, class Enable = void>
+        struct Pusher;
+
+        template<>
+        struct Pusher<void *>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, void * _val, const Policy & _policy = Policy())
+            {
+                if (!_val)
+                    lua_pushnil(_luaState);
+                else
+                    lua_pushlightuserdata(_luaState, _val);
+                return 1;
+            }
+        };
+
+        //we need a special pusher for const char* as the rules for removing cv, reference and pointer
+        //don't apply to it.
+        template<>
+        struct Pusher<const char *>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, const char * _val, const Policy & _policy = Policy())
+            {
+                if (!_val)
+                    lua_pushnil(_luaState);
+                else
+                    lua_pushstring(_luaState, _val);
+                return 1;
+            }
+        };
+
+        template <class T>
+        struct Pusher<T *>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, T * _val, const Policy & _policy = Policy())
+            {
+                return ApplyPolicyPtr<Policy>::apply(_luaState, _val, _policy);
+            }
+        };
+
+        template <class T>
+        struct Pusher<T * const>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, T * const _val, const Policy & _policy = Policy())
+            {
+                return ApplyPolicyPtr<Policy>::apply(_luaState, _val, _policy);
+            }
+        };
+
+        // // We need to do an overload using std::ref
+        // template <class T>
+        // struct Pusher<const std::reference_wrapper<T> & >
+        // {
+        //     template<class Policy>
+        //     static void push(lua_State * _luaState, const std::reference_wrapper<T> & _val, const Policy & _policy = Policy())
+        //     {
+        //         luanatic::push<typename RawType<T>::Type>(_luaState, &_val.get(), false);
+        //     }
+        // };
+
+        //non const references are pushed as borrowed objects, no matter the policy...
+        template <class P>
+        struct ApplyPolicyRef
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, T & _val, const P & _policy)
+            {
+                luanatic::push<typename RawType<T>::Type>(_luaState, &_val, false);
+                return 1;
+            }
+        };
+
+        //...but the ones that should become writable buffers
+        template <class G>
+        struct ApplyPolicyRef<ReturnBuffer<G>>
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _luaState, T & _val, const ReturnBuffer<G> & _policy)
+            {
+                return _policy.push(_luaState, &_val);
+            }
+        };
+
+        template <class T>
+        struct Pusher<T &>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, T & _val, const Policy & _policy = Policy())
+            {
+                return ApplyPolicyRef<Policy>::apply(_luaState, _val, _policy);
+            }
+        };
+
+        template <class T>
+        struct Pusher<const T &>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, const T & _val, const Policy & _policy = Policy())
+            {
+                return ApplyPolicyValueType<Policy>::apply(_luaState, _val, _policy);
+            }
+        };
+
+        template <class T>
+        struct Pusher<T>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, const T & _val, const Policy & _policy = Policy())
+            {
+                return ApplyPolicyValueType<Policy>::apply(_luaState, _val, _policy);
+            }
+
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, T && _val, const Policy & _policy = Policy())
+            {
+                return ApplyPolicyValueType<Policy>::apply(_luaState, std::move(_val), _policy);
+            }
+        };
+
+        // this is a specialization for char arrays to push them as a string ...
+        template <stick::Size N>
+        struct Pusher<const char (&) [N]>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _luaState, const char (&_val)[N], const Policy & _policy = Policy())
+        {
+            lua_pushstring(_luaState, _val);
+            return 1;
+        }
+                    };
+
+        template<class T>
+        struct PickPusher
+        {
+            template<class T2, class Policy>
+            static stick::Int32 push(lua_State * _state, T2 && _value, const Policy & _policy)
+            {
+                return Pusher<T>::push(_state, std::forward<T2>(_value), _policy);
+            }
+        };
+
+        //we forward references as const references by default...
+        template<class T>
+        struct PickPusher<T &>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _state, const T & _value, const Policy & _policy)
+            {
+                return Pusher<const T &>::push(_state, std::forward<const T &>(_value), _policy);
+            }
+        };
+
+        //...unless std::ref is used
+        template<class T>
+        struct PickPusher<const std::reference_wrapper<T> &>
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _state, const std::reference_wrapper<T> & _value, const Policy & _policy)
+            {
+                return Pusher<T &>::push(_state, std::forward<T &>(_value.get()), _policy);
+            }
+        };
+
+        template<class T>
+        struct PickPusher<T *& >
+        {
+            template<class Policy>
+            static stick::Int32 push(lua_State * _state, T * _value, const Policy & _policy)
+            {
+                return Pusher<T *>::push(_state, std::forward<T *>(_value), _policy);
+            }
+        };
+    }
+
+    template<class F>
+    struct Transfer
+    {
+        using Target = F;
+
+        template<class T>
+        stick::Int32 push(lua_State * _luaState, T * _val) const
+        {
+            luanatic::push<T>(_luaState, _val, true);
+            return 1;
+        }
+    };
+
+    template<class F>
+    struct DefaultValue
+    {
+
+    };
+
+    namespace detail
+    {
+        template<stick::Size N>
+        struct IndexToPlaceHolder;
+
+        template<>
+        struct IndexToPlaceHolder<1> { using Value = ph::One; };
+
+        template<>
+        struct IndexToPlaceHolder<2> { using Value = ph::Two; };
+
+        template<>
+        struct IndexToPlaceHolder<3> { using Value = ph::Three; };
+
+        template<>
+        struct IndexToPlaceHolder<4> { using Value = ph::Four; };
+
+        template<>
+        struct IndexToPlaceHolder<5> { using Value = ph::Five; };
+
+        template<>
+        struct IndexToPlaceHolder<6> { using Value = ph::Six; };
+
+        template<>
+        struct IndexToPlaceHolder<7> { using Value = ph::Seven; };
+
+        template<>
+        struct IndexToPlaceHolder<8> { using Value = ph::Eight; };
+
+        template<>
+        struct IndexToPlaceHolder<9> { using Value = ph::Nine; };
+
+        template<>
+        struct IndexToPlaceHolder<10> { using Value = ph::Ten; };
+
+        template <class T, class Enable = void>
+        struct Converter;
+
+        template <>
+        struct Converter<void *>
+        {
+            using Ret = void*;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                //TODO Check if this is userdata
+                return lua_touserdata(_luaState, _index);
+            }
+        };
+
+        // we need a special converter to c string because
+        // otherwise it tries to treat it like any other pointer.
+        template <>
+        struct Converter<const char *>
+        {
+            using Ret = const char*;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                return luaL_checkstring(_luaState, _index);
+            }
+        };
+
+        // Convert to a raw pointer type.
+        template <class T>
+        struct Converter<T *>
+        {
+            using Ret = T*;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                Ret ret = convertToTypeAndCheck<typename RawType<T>::Type>(
+                              _luaState, _index);
+                return ret;
+            }
+        };
+
+        // Convert to a reference type
+        template <class T>
+        struct Converter<T &>
+        {
+            using Ret = T&;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                Ret ret = *(convertToTypeAndCheck<typename RawType<T>::Type>(
+                                _luaState, _index));
+                return ret;
+            }
+        };
+
+        //helper to only forward to ValueTypeConverter for const reference types
+        //if the type has a default constructor
+        template<class T, class Enable = void>
+        struct ConverterHelper
+        {
+            static const T * convert(lua_State * _luaState, stick::Int32 _index, LuanaticState * _lnstate)
+            {
+                //Try implicitly converting from lua, we need the return proxy to clean up
+                //the tmp memory we need for this.
+                auto ptr = _lnstate->m_allocator->create<T>(convertToValueTypeAndCheck<typename RawType<T>::Type>(_luaState, _index));
+                return ptr;
+            }
+        };
+
+        template<class T>
+        struct ConverterHelper < T, typename std::enable_if < !std::is_default_constructible<T>::value >::type >
+        {
+            static const T * convert(lua_State * _luaState, stick::Int32 _index, LuanaticState * _lnstate)
+            {
+                return nullptr;
+            }
+        };
+
+        template <class T>
+        struct Converter<const T &>
+        {
+            struct ReturnProxy
+            {
+                ReturnProxy(const T & _ref) :
+                    ptr(nullptr),
+                    ref(_ref)
+                {
+
+                }
+
+                ReturnProxy(const T * _ptr, stick::Allocator * _alloc) :
+                    ptr(_ptr),
+                    alloc(_alloc),
+                    ref(*_ptr)
+                {
+
+                }
+
+                ReturnProxy(ReturnProxy && _other) :
+                    ptr(_other.ptr),
+                    ref(*ptr)
+                {
+                    _other.ptr = nullptr;
+                }
+
+                ~ReturnProxy()
+                {
+                    if (ptr)
+                    {
+                        alloc->destroy(ptr);
+                    }
+                }
+
+                ReturnProxy(const ReturnProxy & _other) = delete;
+                ReturnProxy & operator = (const ReturnProxy & _other) = delete;
+
+                operator const T & ()
+                {
+                    return ref;
+                }
+
+                const T * ptr;
+                stick::Allocator * alloc;
+                const T & ref;
+            };
+
+            using Ret = ReturnProxy;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                T * ret = convertToType<typename RawType<T>::Type>(_luaState, _index);
+                if (ret)
+                {
+                    return ReturnProxy(*ret);
+                }
+                else
+                {
+                    //Try implicitly converting from lua, we need the return proxy to clean up
+                    //the tmp memory we need for this.
+                    LuanaticState * ls = luanaticState(_luaState);
+                    STICK_ASSERT(ls);
+                    return ReturnProxy(ConverterHelper<T>::convert(_luaState, _index, ls), ls->m_allocator);
+                }
+            }
+        };
+
+        // convert to a value type
+        template <class T>
+        struct Converter<T>
+        {
+            using Ret = T;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                Ret ret = convertToValueTypeAndCheck<typename RawType<T>::Type>(_luaState, _index);
+                return ret;
+            }
+        };
+
+        //function arguments stay on the stack during the call, so views of them stay valid
+        template <>
+        struct Converter<StringView>
+        {
+            using Ret = StringView;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                size_t len;
+                const char * str = luaL_checklstring(_luaState, _index, &len);
+                return StringView(str, len);
+            }
+        };
+
+        //string views don't need the temporary that other const references might
+        template <>
+        struct Converter<const StringView &> : public Converter<StringView> {};
+
+        //checks and converts the element on top of the stack for TableView<T>
+        template<class T, bool IsNumber = IsArrayNumber<T>::value>
+        struct TableViewElement
+        {
+            static bool check(lua_State * _luaState)
+            {
+                return conversionScore<T>(_luaState, -1) != std::numeric_limits<stick::Int32>::max();
+            }
+
+            static T convert(lua_State * _luaState, stick::Size _luaIndex)
+            {
+                return Converter<T>::convert(_luaState, -1);
+            }
+        };
+
+        template<class T>
+        struct TableViewElement<T, true>
+        {
+            static bool check(lua_State * _luaState)
+            {
+                T tmp;
+                return toArrayNumber(_luaState, -1, tmp);
+            }
+
+            static T convert(lua_State * _luaState, stick::Size _luaIndex)
+            {
+                T ret;
+                if (!toArrayNumber(_luaState, -1, ret))
+                    luaErrorWithStackTrace(_luaState, 1, "Number expected at index %d of table", static_cast<int>(_luaIndex));
+                return ret;
+            }
+        };
+
+        template <class T>
+        struct Converter<TableView<T>>
+        {
+            using Ret = TableView<T>;
+
+            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            {
+                if (!lua_istable(_luaState, _index))
+                {
+                    const char * msg = lua_pushfstring(_luaState, "Table expected, got %s", luaL_typename(_luaState, _index));
+                    luaL_argerror(_luaState, _index, msg);
+                }
+
+                //the elements are only converted once the function accesses them, an error raised from
+                //there would jump past its destructors. So their types are checked before the call.
+                stick::Int32 index = absIndex(_luaState, _index);
+                stick::Size len = rawLen(_luaState, index);
+                for (stick::Size i = 1; i <= len; ++i)
+                {
+                    lua_rawgeti(_luaState, index, static_cast<lua_Integer>(i));
+                    if (!TableViewElement<T>::check(_luaState))
+                    {
+                        luaErrorWithStackTrace(_luaState, index, "Unexpected %s at index %d of table",
+                                               luaL_typename(_luaState, -1), static_cast<int>(i));
+                    }
+                    lua_pop(_luaState, 1);
+                }
+                return TableView<T>(_luaState, index);
+            }
+        };
+
+        template <class T>
+        struct Converter<const TableView<T> &> : public Converter<TableView<T>> {};
+
+        template<class T>
+        struct LuaTypeScore<TableView<T>>
+        {
+            using ShapeOnly = std::true_type;
+
+            static stick::Int32 score(lua_State * _luaState, stick::Int32 _index)
+            {
+                return lua_istable(_luaState, _index) ? 1 : std::numeric_limits<stick::Int32>::max();
+            }
+        };
+
+        template<class T>
+        typename Converter<T>::Ret convert(lua_State * _luaState, stick::Int32 _index)
+        {
+            return Converter<T>::convert(_luaState, _index);
+        }
+
+        inline bool checkArgumentCount(lua_State * _luaState,
+                                       stick::UInt32 _targetCount,
+                                       stick::UInt32 _luaArgCountAdjust,
+                                       stick::UInt32 & _outActualCount)
+        {
+            _outActualCount = lua_gettop(_luaState) + _luaArgCountAdjust;
+            if (_outActualCount == _targetCount)
+                return true;
+            return false;
+        }
+
+        inline bool checkArgumentCountAndEmitLuaError(lua_State * _luaState, stick::UInt32 _targetCount, stick::UInt32 _luaArgCountAdjust)
+        {
+            stick::UInt32 actualArgCount;
+            if (!checkArgumentCount(_luaState, _targetCount, _luaArgCountAdjust, actualArgCount))
+            {
+                luaErrorWithStackTrace(_luaState, 0, "Expected %d, got %d", _targetCount, actualArgCount);
+                return false;
+            }
+            return true;
+        }
+
+        template<class T, T... Ints> struct integer_sequence
+        {
+        };
+
+        template<class S> struct next_integer_sequence;
+
+        template<class T, T... Ints> struct next_integer_sequence<integer_sequence<T, Ints...>>
+        {
+            using type = integer_sequence<T, Ints..., sizeof...(Ints)>;
+        };
+
+        template<class T, T I, T N> struct make_int_seq_impl;
+
+        template<class T, T N>
+        using make_integer_sequence = typename make_int_seq_impl<T, 0, N>::type;
+
+        template<class T, T I, T N> struct make_int_seq_impl
+        {
+            using type = typename next_integer_sequence <
+                         typename make_int_seq_impl < T, I + 1, N >::type >::type;
+        };
+
+        template<class T, T N> struct make_int_seq_impl<T, N, N>
+        {
+            using type = integer_sequence<T>;
+        };
 
-    namespace placeHolders
-    {
-        struct Result {};
-        struct One {};
-        struct Two {};
-        struct Three {};
-        struct Four {};
-        struct Five {};
-        struct Six {};
-        struct Seven {};
-        struct Eight {};
-        struct Nine {};
-        struct Ten {};
-    }
+        template<std::size_t... Ints>
+        using index_sequence = integer_sequence<std::size_t, Ints...>;
 
-    namespace ph = placeHolders;
+        template<std::size_t N>
+        using make_index_sequence = make_integer_sequence<std::size_t, N>;
 
-    namespace detail
-    {
-        struct NoPolicy {};
 
-        template <class P>
-        struct ApplyPolicyPtr
+        template<bool B, class Either, class Or>
+        struct MatchResult;
+
+        template<class Either, class Or>
+        struct MatchResult<true, Either, Or>
         {
-            template<class T>
-            static stick::Int32 apply(lua_State * _luaState, T * _val, const P & _policy)
-            {
-                return _policy.template push<typename RawType<T>::Type>(_luaState, _val);
-            }
+            using Result = Either;
         };
 
-        template <>
-        struct ApplyPolicyPtr<NoPolicy>
+        template<class Either, class Or>
+        struct MatchResult<false, Either, Or>
         {
-            template<class T>
-            static stick::Int32 apply(lua_State * _luaState, T * _val, const NoPolicy & _p)
-            {
-                if (!_val)
-                    lua_pushnil(_luaState);
-                else
-                    luanatic::push<typename RawType<T>::Type>(_luaState, _val, false);
-                return 1;
-            }
+            using Result = Or;
         };
 
+        template<class For, class Default, class Current, class...Rest>
+        struct GetPolicyImpl
+        {
+            using Policy = typename MatchResult<std::is_same<For, typename Current::Target>::value,
+                  Current,
+                  typename GetPolicyImpl<For, Default, Rest...>::Policy>::Result;
+        };
 
-        template <class P>
-        struct ApplyPolicyValueType
+        template<class For, class Default, class Current>
+        struct GetPolicyImpl<For, Default, Current>
         {
-            template<class T>
-            static stick::Int32 apply(lua_State * _luaState, const T & _val, const P & _policy)
-            {
-                return _policy.template push<typename RawType<T>::Type>(_luaState, _val);
-            }
+            using Policy = typename MatchResult<std::is_same<For, typename Current::Target>::value,
+                  Current, Default>::Result;
         };
 
-        template <>
-        struct ApplyPolicyValueType<NoPolicy>
+        template<class For, class Default, class...Policies>
+        struct GetPolicy
         {
-            template<class T>
-            static stick::Int32 apply(lua_State * _luaState, const T & _val, const NoPolicy & _p)
-            {
-                return luanatic::pushValueType<typename RawType<T>::Type>(_luaState, _val);
-            }
+            using Policy = typename GetPolicyImpl<For, Default, Policies...>::Policy;
+        };
+
+        template<class For, class Default>
+        struct GetPolicy<For, Default>
+        {
+            using Policy = Default;
         };
 
+        template <class Ret, class F, class...Args, std::size_t...N>
+        inline Ret callFunctionImpl(lua_State * _state, F _callable, index_sequence<N...>)
+        {
+            return _callable(convert<Args>(_state, N)...);
+        }
 
-        template <class T, class Enable = void>
-        struct Pusher;
+        template<class Ret, class F, class...Args>
+        inline Ret callFunction(lua_State * _state, F _callable)
+        {
+            return callFunctionImpl<Ret>(_state, _callable, make_index_sequence<sizeof...(Args)>());
+        }
 
-        template<>
-        struct Pusher<void *>
+        template<class T>
+        struct RawTypeName
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, void * _val, const Policy & _policy = Policy())
+            static stick::String name()
             {
-                if (!_val)
-                    lua_pushnil(_luaState);
-                else
-                    lua_pushlightuserdata(_luaState, _val);
-                return 1;
+                return demangleTypeName(typeid(T).name());
             }
         };
 
-        //we need a special pusher for const char* as the rules for removing cv, reference and pointer
-        //don't apply to it.
-        template<>
-        struct Pusher<const char *>
+        template<class T>
+        struct ArgName
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, const char * _val, const Policy & _policy = Policy())
+            static stick::String name(std::size_t _argCount, std::size_t _idx)
             {
-                if (!_val)
-                    lua_pushnil(_luaState);
-                else
-                    lua_pushstring(_luaState, _val);
-                return 1;
+                stick::String ret;
+                ret.append(RawTypeName<T>::name());
+                if (std::is_const<typename std::remove_reference<T>::type>::value)
+                    ret.append(" const");
+                if (std::is_lvalue_reference<T>::value)
+                    ret.append("&");
+                if (std::is_rvalue_reference<T>::value)
+                    ret.append("&&");
+                if (_idx < _argCount - 1)
+                    ret.append(", ");
+                return ret;
             }
         };
 
-        template <class T>
-        struct Pusher<T *>
+
+        template<class...Args>
+        struct SignatureName
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, T * _val, const Policy & _policy = Policy())
+            static stick::String name()
             {
-                return ApplyPolicyPtr<Policy>::apply(_luaState, _val, _policy);
+                return nameImpl(make_index_sequence<sizeof...(Args)>());
+            }
+
+            template<std::size_t...N>
+            static stick::String nameImpl(index_sequence<N...>)
+            {
+                return stick::String::concat("(", ArgName<Args>::name(sizeof...(Args), N)..., ")");
             }
         };
 
-        template <class T>
-        struct Pusher<T * const>
+        template<class...Args>
+        struct ArgScore
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, T * const _val, const Policy & _policy = Policy())
+            static constexpr bool bShapeOnly = AllOf<HasShapeOnlyScore<Args>::value...>::value;
+
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _indexOff,
+                                      stick::Int32 _defaultArgCount)
             {
-                return ApplyPolicyPtr<Policy>::apply(_luaState, _val, _policy);
+                //@TODO: I think some of the arg count checks might
+                //be redundant, double check!
+                if (!_argCount)
+                {
+                    if (sizeof...(Args) - _defaultArgCount == 0)
+                        return 0;
+                    else
+                        return std::numeric_limits<stick::Int32>::max();
+                }
+
+                if (_argCount > sizeof...(Args) || _argCount < sizeof...(Args) - _defaultArgCount)
+                    return std::numeric_limits<stick::Int32>::max();
+                stick::Int32 ret = 0;
+                scoreImpl(_luaState, _indexOff, ret, _argCount + 1, make_index_sequence<sizeof...(Args)>());
+                return ret;
+            }
+
+        private:
+
+            template<class Arg>
+            static stick::Int32 scoreHelper(lua_State * _luaState, stick::Int32 _index, stick::Int32 _maxIdx, stick::Int32 & _outResult)
+            {
+                if (_index <= _maxIdx)
+                {
+                    auto s = conversionScore<Arg>(_luaState, _index);
+                    if (std::numeric_limits<stick::Int32>::max() - _outResult >= s)
+                        _outResult += conversionScore<Arg>(_luaState, _index);
+                    else
+                        _outResult = std::numeric_limits<stick::Int32>::max();
+                }
+                return _outResult;
+            }
+
+            template<std::size_t...N>
+            static void scoreImpl(lua_State * _luaState, stick::Int32 _indexOff, stick::Int32 & _outResult, stick::Int32 _maxIdx, index_sequence<N...>)
+            {
+                stick::Int32 xs[] = {scoreHelper<Args>(_luaState, 1 + N + _indexOff, _maxIdx, _outResult)...};
             }
         };
 
-        // // We need to do an overload using std::ref
-        // template <class T>
-        // struct Pusher<const std::reference_wrapper<T> & >
-        // {
-        //     template<class Policy>
-        //     static void push(lua_State * _luaState, const std::reference_wrapper<T> & _val, const Policy & _policy = Policy())
-        //     {
-        //         luanatic::push<typename RawType<T>::Type>(_luaState, &_val.get(), false);
-        //     }
-        // };
+        template <class T, T Func, class...Policies>
+        struct FunctionWrapper;
+
+        template <class Ret, class... Args, Ret (*Func)(Args...), class...Policies>
+        struct FunctionWrapper<Ret(*)(Args...), Func, Policies...>
+        {
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
+        {
+            *_outDefaultArgsNeeded = sizeof...(Args) - _argCount;
+            return ArgScore<Args...>::score(_luaState, _argCount, 0, _defaultArgCount);
+        }
+
+        static stick::String signatureStr()
+        {
+            return SignatureName<Args...>::name();
+        }
+
+        static stick::Size argCount()
+        {
+            return sizeof...(Args);
+        }
+
+
+        static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
+
+        static stick::Int32 func(lua_State * _luaState)
+        {
+            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+        }
+
+        template<std::size_t...N>
+        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        {
+            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), 0);
+            using Policy = typename GetPolicy<ph::Result, NoPolicy, Policies...>::Policy;
+            return Pusher<Ret>::push(_luaState, (*Func)(convert<Args>(_luaState, 1 + N)...), Policy());
+        }
+                };
 
-        template <class T>
-        struct Pusher<T &>
+        template <class... Args, void (*Func)(Args...), class...Policies>
+        struct FunctionWrapper<void(*)(Args...), Func, Policies...>
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, T & _val, const Policy & _policy = Policy())
-            {
-                luanatic::push<typename RawType<T>::Type>(_luaState, &_val, false);
-                return 1;
-            }
-        };
 
-        template <class T>
-        struct Pusher<const T &>
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, const T & _val, const Policy & _policy = Policy())
-            {
-                return ApplyPolicyValueType<Policy>::apply(_luaState, _val, _policy);
-            }
-        };
+            *_outDefaultArgsNeeded = sizeof...(Args) - _argCount;
+            return ArgScore<Args...>::score(_luaState, _argCount, 0, _defaultArgCount);
+        }
 
-        template <class T>
-        struct Pusher<T>
+        static stick::String signatureStr()
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, const T & _val, const Policy & _policy = Policy())
-            {
-                return ApplyPolicyValueType<Policy>::apply(_luaState, _val, _policy);
-            }
-        };
+            return SignatureName<Args...>::name();
+        }
 
-        // this is a specialization for char arrays to push them as a string ...
-        template <stick::Size N>
-        struct Pusher<const char (&) [N]>
+        static stick::Size argCount()
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _luaState, const char (&_val)[N], const Policy & _policy = Policy())
+            return sizeof...(Args);
+        }
+
+
+        static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
+
+        static stick::Int32 func(lua_State * _luaState)
         {
-            lua_pushstring(_luaState, _val);
-            return 1;
+            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
         }
-                    };
 
-        template<class T>
-        struct PickPusher
+        template<std::size_t...N>
+        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
         {
-            template<class T2, class Policy>
-            static stick::Int32 push(lua_State * _state, T2 && _value, const Policy & _policy)
-            {
-                return Pusher<T>::push(_state, std::forward<T2>(_value), _policy);
-            }
-        };
+            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), 0);
+            (*Func)(convert<Args>(_luaState, 1 + N)...);
+            return 0;
+        }
+                };
 
-        //we forward references as const references by default...
-        template<class T>
-        struct PickPusher<T &>
+        template <class Ret, class C, class... Args, Ret (C::*Func)(Args...), class...Policies>
+        struct FunctionWrapper<Ret (C::*)(Args...), Func, Policies...>
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _state, const T & _value, const Policy & _policy)
-            {
-                return Pusher<const T &>::push(_state, std::forward<const T &>(_value), _policy);
-            }
-        };
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
+        {
+            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
+            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+        }
 
-        //...unless std::ref is used
-        template<class T>
-        struct PickPusher<const std::reference_wrapper<T> &>
+        static stick::String signatureStr()
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _state, const std::reference_wrapper<T> & _value, const Policy & _policy)
-            {
-                return Pusher<T &>::push(_state, std::forward<T &>(_value.get()), _policy);
-            }
-        };
+            return SignatureName<Args...>::name();
+        }
 
-        template<class T>
-        struct PickPusher<T *& >
+        static stick::Size argCount()
         {
-            template<class Policy>
-            static stick::Int32 push(lua_State * _state, T * _value, const Policy & _policy)
-            {
-                return Pusher<T *>::push(_state, std::forward<T *>(_value), _policy);
-            }
-        };
-    }
+            return sizeof...(Args) + 1; //self is the first lua argument
+        }
 
-    template<class F>
-    struct Transfer
-    {
-        using Target = F;
+        static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
 
-        template<class T>
-        stick::Int32 push(lua_State * _luaState, T * _val) const
+        static stick::Int32 func(lua_State * _luaState)
         {
-            luanatic::push<T>(_luaState, _val, true);
-            return 1;
+            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
         }
-    };
 
-    template<class F>
-    struct DefaultValue
-    {
+        template<std::size_t...N>
+        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        {
+            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
+            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
+            using Policy = typename GetPolicy<ph::Result, NoPolicy, Policies...>::Policy;
+            return Pusher<Ret>::push(_luaState, (obj->*Func)(convert<Args>(_luaState, 2 + N)...), Policy());
+        }
+                };
 
-    };
+        template <class Ret, class C, class... Args, Ret (C::*Func)(Args...) const, class...Policies>
+        struct FunctionWrapper<Ret (C::*)(Args...) const, Func, Policies...>
+        {
 
-    namespace detail
-    {
-        template<stick::Size N>
-        struct IndexToPlaceHolder;
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
+        {
+            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
+            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+        }
 
-        template<>
-        struct IndexToPlaceHolder<1> { using Value = ph::One; };
+        static stick::String signatureStr()
+        {
+            return SignatureName<Args...>::name();
+        }
 
-        template<>
-        struct IndexToPlaceHolder<2> { using Value = ph::Two; };
+        static stick::Size argCount()
+        {
+            return sizeof...(Args) + 1; //self is the first lua argument
+        }
 
-        template<>
-        struct IndexToPlaceHolder<3> { using Value = ph::Three; };
+        static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
 
-        template<>
-        struct IndexToPlaceHolder<4> { using Value = ph::Four; };
+        static stick::Int32 func(lua_State * _luaState)
+        {
+            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+        }
 
-        template<>
-        struct IndexToPlaceHolder<5> { using Value = ph::Five; };
+        template<std::size_t...N>
+        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        {
+            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
+            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
+            using Policy = typename GetPolicy<ph::Result, NoPolicy, Policies...>::Policy;
+            return Pusher<Ret>::push(_luaState, (obj->*Func)(convert<Args>(_luaState, 2 + N)...), Policy());
+        }
+                };
 
-        template<>
-        struct IndexToPlaceHolder<6> { using Value = ph::Six; };
+        template <class C, class... Args, void (C::*Func)(Args...), class...Policies>
+        struct FunctionWrapper<void (C::*)(Args...), Func, Policies...>
+        {
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
+        {
+            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
+            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+        }
 
-        template<>
-        struct IndexToPlaceHolder<7> { using Value = ph::Seven; };
+        static stick::String signatureStr()
+        {
+            return SignatureName<Args...>::name();
+        }
 
-        template<>
-        struct IndexToPlaceHolder<8> { using Value = ph::Eight; };
+        static stick::Size argCount()
+        {
+            return sizeof...(Args) + 1; //self is the first lua argument
+        }
 
-        template<>
-        struct IndexToPlaceHolder<9> { using Value = ph::Nine; };
+        static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
 
-        template<>
-        struct IndexToPlaceHolder<10> { using Value = ph::Ten; };
+        static stick::Int32 func(lua_State * _luaState)
+        {
+            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+        }
 
-        template <class T, class Enable = void>
-        struct Converter;
+        template<std::size_t...N>
+        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        {
+            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
+            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
+            (obj->*Func)(convert<Args>(_luaState, 2 + N)...);
+            return 0;
+        }
+                };
 
-        template <>
-        struct Converter<void *>
+        template <class C, class... Args, void (C::*Func)(Args...) const, class...Policies>
+        struct FunctionWrapper<void (C::*)(Args...) const, Func, Policies...>
         {
-            using Ret = void*;
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
+        {
+            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
+            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+        }
 
-            static Ret convert(lua_State * _luaState, stick::Int32 _index)
-            {
-                //TODO Check if this is userdata
-                return lua_touserdata(_luaState, _index);
-            }
-        };
+        static stick::String signatureStr()
+        {
+            return SignatureName<Args...>::name();
+        }
 
-        // we need a special converter to c string because
-        // otherwise it tries to treat it like any other pointer.
-        template <>
-        struct Converter<const char *>
+        static stick::Size argCount()
         {
-            using Ret = const char*;
+            return sizeof...(Args) + 1; //self is the first lua argument
+        }
 
-            static Ret convert(lua_State * _luaState, stick::Int32 _index)
-            {
-                return luaL_checkstring(_luaState, _index);
-            }
-        };
+        static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
 
-        // Convert to a raw pointer type.
-        template <class T>
-        struct Converter<T *>
+        static stick::Int32 func(lua_State * _luaState)
         {
-            using Ret = T*;
-
-            static Ret convert(lua_State * _luaState, stick::Int32 _index)
-            {
-                Ret ret = convertToTypeAndCheck<typename RawType<T>::Type>(
-                              _luaState, _index);
-                return ret;
-            }
-        };
+            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+        }
 
-        // Convert to a reference type
-        template <class T>
-        struct Converter<T &>
+        template<std::size_t...N>
+        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
         {
-            using Ret = T&;
+            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
+            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
+            (obj->*Func)(convert<Args>(_luaState, 2 + N)...);
+            return 0;
+        }
+                };
 
-            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+        template <class T, T Attr>
+        struct AttributeWrapper;
+
+        template <class Ret, class C, Ret * C::*Member>
+        struct AttributeWrapper<Ret * C::*, Member>
+        {
+            static stick::Int32 func(lua_State * _luaState)
             {
-                Ret ret = *(convertToTypeAndCheck<typename RawType<T>::Type>(
-                                _luaState, _index));
-                return ret;
+                C * obj = convertToTypeAndCheck<C>(_luaState, 1);
+                if (lua_gettop(_luaState) == 1)
+                {
+                    //no arguments, so get
+                    push<typename RawType<Ret>::Type>(_luaState, obj->*Member, false);
+                    return 1;
+                }
+                else
+                {
+                    //there is an arugment on the stack, so set.
+                    obj->*Member = convertToTypeAndCheck<typename RawType<Ret>::Type>(_luaState, 2);
+                    return 0;
+                }
             }
         };
 
-        //helper to only forward to ValueTypeConverter for const reference types
-        //if the type has a default constructor
         template<class T, class Enable = void>
-        struct ConverterHelper
+        struct AttributePusher
         {
-            static const T * convert(lua_State * _luaState, stick::Int32 _index, LuanaticState * _lnstate)
+            static void push(lua_State * _luaState, T & _val)
             {
-                //Try implicitly converting from lua, we need the return proxy to clean up
-                //the tmp memory we need for this.
-                auto ptr = _lnstate->m_allocator->create<T>(convertToValueTypeAndCheck<typename RawType<T>::Type>(_luaState, _index));
-                return ptr;
+                luanatic::push(_luaState, &_val, false);
             }
         };
 
         template<class T>
-        struct ConverterHelper < T, typename std::enable_if < !std::is_default_constructible<T>::value >::type >
+        struct AttributePusher < T, typename std::enable_if < std::is_integral<T>::value || std::is_enum<T>::value || std::is_floating_point<T>::value >::type >
         {
-            static const T * convert(lua_State * _luaState, stick::Int32 _index, LuanaticState * _lnstate)
+            static void push(lua_State * _luaState, T & _val)
             {
-                return nullptr;
+                luanatic::pushValueType(_luaState, _val);
             }
         };
 
-        template <class T>
-        struct Converter<const T &>
+        template <class Ret, class C, Ret C::*Member>
+        struct AttributeWrapper <Ret C::*, Member>
         {
-            struct ReturnProxy
-            {
-                ReturnProxy(const T & _ref) :
-                    ptr(nullptr),
-                    ref(_ref)
-                {
-
-                }
-
-                ReturnProxy(const T * _ptr, stick::Allocator * _alloc) :
-                    ptr(_ptr),
-                    alloc(_alloc),
-                    ref(*_ptr)
-                {
-
-                }
-
-                ReturnProxy(ReturnProxy && _other) :
-                    ptr(_other.ptr),
-                    ref(*ptr)
-                {
-                    _other.ptr = nullptr;
-                }
-
-                ~ReturnProxy()
-                {
-                    if (ptr)
-                    {
-                        alloc->destroy(ptr);
-                    }
-                }
-
-                ReturnProxy(const ReturnProxy & _other) = delete;
-                ReturnProxy & operator = (const ReturnProxy & _other) = delete;
-
-                operator const T & ()
-                {
-                    return ref;
-                }
-
-                const T * ptr;
-                stick::Allocator * alloc;
-                const T & ref;
-            };
-
-            using Ret = ReturnProxy;
-
-            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            static stick::Int32 func(lua_State * _luaState)
             {
-                T * ret = convertToType<typename RawType<T>::Type>(_luaState, _index);
-                if (ret)
+                C * obj = convertToTypeAndCheck<C>(_luaState, 1);
+                if (lua_gettop(_luaState) == 1)
                 {
-                    return ReturnProxy(*ret);
+                    AttributePusher<Ret>::push(_luaState, obj->*Member);
+                    return 1;
                 }
                 else
                 {
-                    //Try implicitly converting from lua, we need the return proxy to clean up
-                    //the tmp memory we need for this.
-                    LuanaticState * ls = luanaticState(_luaState);
-                    STICK_ASSERT(ls);
-                    return ReturnProxy(ConverterHelper<T>::convert(_luaState, _index, ls), ls->m_allocator);
+                    obj->*Member = convertToValueTypeAndCheck<Ret>(_luaState, 2);
+                    return 0;
                 }
             }
         };
 
-        // convert to a value type
-        template <class T>
-        struct Converter<T>
+        template <class T, class... Args>
+        struct ConstructorWrapper
         {
-            using Ret = T;
-
-            static Ret convert(lua_State * _luaState, stick::Int32 _index)
+            static stick::Int32 score(lua_State * _luaState,
+                                      stick::Int32 _argCount,
+                                      stick::Int32 _defaultArgCount,
+                                      stick::Int32 * _outDefaultArgsNeeded)
             {
-                Ret ret = convertToValueTypeAndCheck<typename RawType<T>::Type>(_luaState, _index);
-                return ret;
+                *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount);
+                return ArgScore<Args...>::score(_luaState, _argCount, 0, _defaultArgCount);
             }
-        };
 
-        template<class T>
-        typename Converter<T>::Ret convert(lua_State * _luaState, stick::Int32 _index)
-        {
-            return Converter<T>::convert(_luaState, _index);
-        }
-
-        inline bool checkArgumentCount(lua_State * _luaState,
-                                       stick::UInt32 _targetCount,
-                                       stick::UInt32 _luaArgCountAdjust,
-                                       stick::UInt32 & _outActualCount)
-        {
-            _outActualCount = lua_gettop(_luaState) + _luaArgCountAdjust;
-            if (_outActualCount == _targetCount)
-                return true;
-            return false;
-        }
+            static stick::String signatureStr()
+            {
+                return SignatureName<Args...>::name();
+            }
 
-        inline bool checkArgumentCountAndEmitLuaError(lua_State * _luaState, stick::UInt32 _targetCount, stick::UInt32 _luaArgCountAdjust)
-        {
-            stick::UInt32 actualArgCount;
-            if (!checkArgumentCount(_luaState, _targetCount, _luaArgCountAdjust, actualArgCount))
+            static stick::Size argCount()
             {
-                luaErrorWithStackTrace(_luaState, 0, "Expected %d, got %d", _targetCount, actualArgCount);
-                return false;
+                return sizeof...(Args);
             }
-            return true;
-        }
 
-        template<class T, T... Ints> struct integer_sequence
-        {
-        };
 
-        template<class S> struct next_integer_sequence;
+            static constexpr bool bShapeOnlyScore = ArgScore<Args...>::bShapeOnly;
 
-        template<class T, T... Ints> struct next_integer_sequence<integer_sequence<T, Ints...>>
-        {
-            using type = integer_sequence<T, Ints..., sizeof...(Ints)>;
-        };
+            //this function serves to have an extra step between converting the arguments
+            //from lua, so that in case of an error, we don't leak the newly created T obj
+            static void create(lua_State * _luaState, Args... _args)
+            {
+                pushNew<T>(_luaState, std::forward<Args>(_args)...);
+            }
 
-        template<class T, T I, T N> struct make_int_seq_impl;
 
-        template<class T, T N>
-        using make_integer_sequence = typename make_int_seq_impl<T, 0, N>::type;
+            static stick::Int32 func(lua_State * _luaState)
+            {
+                return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+            }
 
-        template<class T, T I, T N> struct make_int_seq_impl
-        {
-            using type = typename next_integer_sequence <
-                         typename make_int_seq_impl < T, I + 1, N >::type >::type;
-        };
+            template<std::size_t...N>
+            static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+            {
+                checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), 0);
 
-        template<class T, T N> struct make_int_seq_impl<T, N, N>
-        {
-            using type = integer_sequence<T>;
+                create(_luaState, convert<Args>(_luaState, 1 + N)...);
+                return 1;
+            }
         };
 
-        template<std::size_t... Ints>
-        using index_sequence = integer_sequence<std::size_t, Ints...>;
-
-        template<std::size_t N>
-        using make_index_sequence = make_integer_sequence<std::size_t, N>;
-
-
-        template<bool B, class Either, class Or>
-        struct MatchResult;
-
-        template<class Either, class Or>
-        struct MatchResult<true, Either, Or>
-        {
-            using Result = Either;
-        };
+        template<class Iterator, bool ForceReference>
+        struct IterValuePusher;
 
-        template<class Either, class Or>
-        struct MatchResult<false, Either, Or>
+        template<class Iterator>
+        struct IterValuePusher<Iterator, true>
         {
-            using Result = Or;
+            static void push(lua_State * _luaState, Iterator * _it)
+            {
+                typedef typename stick::IteratorTraits<Iterator>::ValueType ValueType;
+                Pusher<ValueType &>::push(_luaState, **_it, detail::NoPolicy());
+            }
         };
 
-        template<class For, class Default, class Current, class...Rest>
-        struct GetPolicyImpl
+        template<class Iterator>
+        struct IterValuePusher<Iterator, false>
         {
-            using Policy = typename MatchResult<std::is_same<For, typename Current::Target>::value,
-                  Current,
-                  typename GetPolicyImpl<For, Default, Rest...>::Policy>::Result;
+            static void push(lua_State * _luaState, Iterator * _it)
+            {
+                typedef typename stick::IteratorTraits<Iterator>::ValueType ValueType;
+                Pusher<ValueType>::push(_luaState, **_it, detail::NoPolicy());
+            }
         };
 
-        template<class For, class Default, class Current>
-        struct GetPolicyImpl<For, Default, Current>
+        template<class Iterator, bool ForceReference>
+        stick::Int32 iteratorFunction(lua_State * _luaState)
         {
-            using Policy = typename MatchResult<std::is_same<For, typename Current::Target>::value,
-                  Current, Default>::Result;
-        };
+            Iterator * iter = static_cast<Iterator *>(lua_touserdata(_luaState, lua_upvalueindex(1)));
+            Iterator * end = static_cast<Iterator *>(lua_touserdata(_luaState, lua_upvalueindex(2)));
 
-        template<class For, class Default, class...Policies>
-        struct GetPolicy
+            if (iter && end)
+            {
+                if (*iter != *end)
+                {
+                    //push the current iterator value and advance
+                    IterValuePusher<Iterator, ForceReference>::push(_luaState, iter);
+                    ++(*iter);
+                }
+                else
+                {
+                    //we reached the end
+                    lua_pushnil(_luaState);
+                }
+            }
+            else
+            {
+                //emit error
+                lua_pushstring(_luaState, "Invalid c++ iterator pair");
+                lua_error(_luaState);
+            }
+
+            return 1;
+        }
+
+        template<class Iterator, bool ForceReference>
+        struct RangeFunctionPusher;
+
+        template<class Iterator>
+        struct RangeFunctionPusher<Iterator, true>
         {
-            using Policy = typename GetPolicyImpl<For, Default, Policies...>::Policy;
+            static void push(lua_State * _luaState)
+            {
+                lua_pushcclosure(_luaState, iteratorFunction<Iterator, true>, 2);
+            }
         };
 
-        template<class For, class Default>
-        struct GetPolicy<For, Default>
+        template<class Iterator>
+        struct RangeFunctionPusher<Iterator, false>
         {
-            using Policy = Default;
+            static void push(lua_State * _luaState)
+            {
+                lua_pushcclosure(_luaState, iteratorFunction<Iterator, false>, 2);
+            }
         };
 
-        template <class Ret, class F, class...Args, std::size_t...N>
-        inline Ret callFunctionImpl(lua_State * _state, F _callable, index_sequence<N...>)
+        template<bool ForceReference, class Iterator>
+        inline stick::Int32 pushRange(lua_State * _luaState, Iterator _begin, Iterator _end)
         {
-            return _callable(convert<Args>(_state, N)...);
+            pushUnregisteredType<Iterator>(_luaState, _begin);
+            pushUnregisteredType<Iterator>(_luaState, _end);
+            RangeFunctionPusher<Iterator, ForceReference>::push(_luaState);
+            return 1;
         }
 
-        template<class Ret, class F, class...Args>
-        inline Ret callFunction(lua_State * _state, F _callable)
+        template<class T>
+        int _push(lua_State * _luaState, stick::Int32 _startIdx, stick::Int32 _idx, T _value)
         {
-            return callFunctionImpl<Ret>(_state, _callable, make_index_sequence<sizeof...(Args)>());
+            if (_idx >= _startIdx)
+                Pusher<T>::push(_luaState, std::forward<T>(_value), NoPolicy());
+            return 0;
         }
 
-        template<class T>
-        struct RawTypeName
+        template<class...Args>
+        struct DefaultArgs : public DefaultArgsBase
         {
-            static stick::String name()
+            DefaultArgs()
             {
-                return demangleTypeName(typeid(T).name());
             }
-        };
 
-        template<class T>
-        struct ArgName
-        {
-            static stick::String name(std::size_t _argCount, std::size_t _idx)
+            DefaultArgs(Args..._args) :
+                values(_args...)
             {
-                stick::String ret;
-                ret.append(RawTypeName<T>::name());
-                if (std::is_const<typename std::remove_reference<T>::type>::value)
-                    ret.append(" const");
-                if (std::is_lvalue_reference<T>::value)
-                    ret.append("&");
-                if (std::is_rvalue_reference<T>::value)
-                    ret.append("&&");
-                if (_idx < _argCount - 1)
-                    ret.append(", ");
-                return ret;
             }
-        };
 
+            void push(lua_State * _state, stick::Int32 _count) const final
+            {
+                pushHelper(_state, sizeof...(Args) - _count, make_index_sequence<sizeof...(Args)>());
+            }
 
-        template<class...Args>
-        struct SignatureName
-        {
-            static stick::String name()
+            stick::Size argCount() const final
             {
-                return nameImpl(make_index_sequence<sizeof...(Args)>());
+                return sizeof...(Args);
             }
 
-            template<std::size_t...N>
-            static stick::String nameImpl(index_sequence<N...>)
+            template<stick::Size...N>
+            void pushHelper(lua_State * _state, stick::Int32 _startIdx, index_sequence<N...>) const
             {
-                return stick::String::concat("(", ArgName<Args>::name(sizeof...(Args), N)..., ")");
+                int tmp[] = {_push<Args>(_state, _startIdx, N, std::get<N>(values))...};
             }
+
+            std::tuple<Args...> values;
         };
+    }
 
-        template<class...Args>
-        struct ArgScore
+    //function argument type that gives access to the sequence part of a lua table without
+    //converting all of it up front like stick::DynamicArray<T> does. Elements are converted
+    //when they are accessed (T can be anything a function argument can be, but references
+    //and StringView, since the element is popped again before the view could be used).
+    //A view is only valid during the call it was passed to. The element types are checked before
+    //the call, since a conversion error raised from inside the function would longjmp past the
+    //destructors of its locals. That still happens if the function lets lua modify the table.
+    template<class T>
+    class TableView
+    {
+        static_assert(!std::is_same<typename std::decay<T>::type, StringView>::value,
+                      "TableView<StringView> would point to popped strings, use TableView<stick::String>");
+
+    public:
+
+        class Iterator
         {
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _indexOff,
-                                      stick::Int32 _defaultArgCount)
+        public:
+
+            Iterator(const TableView * _view, stick::Size _index) :
+                m_view(_view),
+                m_index(_index)
             {
-                //@TODO: I think some of the arg count checks might
-                //be redundant, double check!
-                if (!_argCount)
-                {
-                    if (sizeof...(Args) - _defaultArgCount == 0)
-                        return 0;
-                    else
-                        return std::numeric_limits<stick::Int32>::max();
-                }
 
-                if (_argCount > sizeof...(Args) || _argCount < sizeof...(Args) - _defaultArgCount)
-                    return std::numeric_limits<stick::Int32>::max();
-                stick::Int32 ret = 0;
-                scoreImpl(_luaState, _indexOff, ret, _argCount + 1, make_index_sequence<sizeof...(Args)>());
-                return ret;
             }
 
-        private:
+            T operator * () const
+            {
+                return (*m_view)[m_index];
+            }
 
-            template<class Arg>
-            static stick::Int32 scoreHelper(lua_State * _luaState, stick::Int32 _index, stick::Int32 _maxIdx, stick::Int32 & _outResult)
+            Iterator & operator ++ ()
             {
-                if (_index <= _maxIdx)
-                {
-                    auto s = conversionScore<Arg>(_luaState, _index);
-                    if (std::numeric_limits<stick::Int32>::max() - _outResult >= s)
-                        _outResult += conversionScore<Arg>(_luaState, _index);
-                    else
-                        _outResult = std::numeric_limits<stick::Int32>::max();
-                }
-                return _outResult;
+                ++m_index;
+                return *this;
             }
 
-            template<std::size_t...N>
-            static void scoreImpl(lua_State * _luaState, stick::Int32 _indexOff, stick::Int32 & _outResult, stick::Int32 _maxIdx, index_sequence<N...>)
+            bool operator == (const Iterator & _other) const
             {
-                stick::Int32 xs[] = {scoreHelper<Args>(_luaState, 1 + N + _indexOff, _maxIdx, _outResult)...};
+                return m_index == _other.m_index;
             }
-        };
 
-        template <class T, T Func, class...Policies>
-        struct FunctionWrapper;
+            bool operator != (const Iterator & _other) const
+            {
+                return m_index != _other.m_index;
+            }
 
-        template <class Ret, class... Args, Ret (*Func)(Args...), class...Policies>
-        struct FunctionWrapper<Ret(*)(Args...), Func, Policies...>
-        {
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
-        {
-            *_outDefaultArgsNeeded = sizeof...(Args) - _argCount;
-            return ArgScore<Args...>::score(_luaState, _argCount, 0, _defaultArgCount);
-        }
+        private:
 
-        static stick::String signatureStr()
-        {
-            return SignatureName<Args...>::name();
-        }
+            const TableView * m_view;
+            stick::Size m_index;
+        };
 
-        static stick::Size argCount()
+        TableView(lua_State * _state, stick::Int32 _index) :
+            m_state(_state),
+            m_index(detail::absIndex(_state, _index)),
+            m_count(detail::rawLen(_state, _index))
         {
-            return sizeof...(Args);
-        }
 
-        static stick::Int32 func(lua_State * _luaState)
-        {
-            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
         }
 
-        template<std::size_t...N>
-        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        //converts the element at the zero based _index
+        T operator [] (stick::Size _index) const
         {
-            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), 0);
-            using Policy = typename GetPolicy<ph::Result, NoPolicy, Policies...>::Policy;
-            return Pusher<Ret>::push(_luaState, (*Func)(convert<Args>(_luaState, 1 + N)...), Policy());
+            STICK_ASSERT(_index < m_count);
+            lua_rawgeti(m_state, m_index, static_cast<lua_Integer>(_index + 1));
+            T ret = detail::TableViewElement<T>::convert(m_state, _index + 1);
+            lua_pop(m_state, 1);
+            return ret;
         }
-                };
-
-        template <class... Args, void (*Func)(Args...), class...Policies>
-        struct FunctionWrapper<void(*)(Args...), Func, Policies...>
-        {
 
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
+        stick::Size count() const
         {
-            *_outDefaultArgsNeeded = sizeof...(Args) - _argCount;
-            return ArgScore<Args...>::score(_luaState, _argCount, 0, _defaultArgCount);
+            return m_count;
         }
 
-        static stick::String signatureStr()
+        Iterator begin() const
         {
-            return SignatureName<Args...>::name();
+            return Iterator(this, 0);
         }
 
-        static stick::Size argCount()
+        Iterator end() const
         {
-            return sizeof...(Args);
+            return Iterator(this, m_count);
         }
 
-        static stick::Int32 func(lua_State * _luaState)
+        lua_State * luaState() const
         {
-            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+            return m_state;
         }
 
-        template<std::size_t...N>
-        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        stick::Int32 stackIndex() const
         {
-            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), 0);
-            (*Func)(convert<Args>(_luaState, 1 + N)...);
-            return 0;
+            return m_index;
         }
-                };
 
-        template <class Ret, class C, class... Args, Ret (C::*Func)(Args...), class...Policies>
-        struct FunctionWrapper<Ret (C::*)(Args...), Func, Policies...>
-        {
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
-        {
-            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
-            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
-        }
+    private:
 
-        static stick::String signatureStr()
+        lua_State * m_state;
+        stick::Int32 m_index;
+        stick::Size m_count;
+    };
+
+    template<class G>
+    struct ReturnIterator
+    {
+        using Target = G;
+
+        template<class T>
+        stick::Int32 push(lua_State * _luaState, const T & _container) const
         {
-            return SignatureName<Args...>::name();
+            return detail::pushRange<false>(_luaState, _container.begin(), _container.end());
         }
+    };
+
+    template<class G>
+    struct ReturnRefIterator
+    {
+        using Target = G;
 
-        static stick::Size argCount()
+        template<class T>
+        stick::Int32 push(lua_State * _luaState, const T & _container) const
         {
-            return sizeof...(Args);
+            return detail::pushRange<true>(_luaState, _container.begin(), _container.end());
         }
+    };
 
-        static stick::Int32 func(lua_State * _luaState)
+    namespace detail
+    {
+        //the userdata of a buffer
+        struct STICK_LOCAL BufferData
         {
-            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
-        }
+            void * m_data;
+            stick::Size m_count;
+            BufferElementType m_elementType;
+            bool m_bReadOnly;
+        };
 
-        template<std::size_t...N>
-        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        //returns the buffer at _index or nullptr if it is not one
+        inline BufferData * toBuffer(lua_State * _state, stick::Int32 _index)
         {
-            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
-            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
-            using Policy = typename GetPolicy<ph::Result, NoPolicy, Policies...>::Policy;
-            return Pusher<Ret>::push(_luaState, (obj->*Func)(convert<Args>(_luaState, 2 + N)...), Policy());
+            void * ud = lua_touserdata(_state, _index);
+            if (!ud || !lua_getmetatable(_state, _index))
+                return nullptr;
+            LuanaticState * ls = luanaticState(_state);
+            lua_rawgeti(_state, LUA_REGISTRYINDEX, ls->m_bufferMetatableRef);
+            bool bIsBuffer = lua_rawequal(_state, -1, -2) != 0;
+            lua_pop(_state, 2);
+            return bIsBuffer ? static_cast<BufferData *>(ud) : nullptr;
         }
-                };
 
-        template <class Ret, class C, class... Args, Ret (C::*Func)(Args...) const, class...Policies>
-        struct FunctionWrapper<Ret (C::*)(Args...) const, Func, Policies...>
+        inline BufferData * checkBuffer(lua_State * _state, stick::Int32 _index)
         {
+            BufferData * ret = toBuffer(_state, _index);
+            if (!ret)
+                luaErrorWithStackTrace(_state, _index, "Buffer expected, got %s", luaL_typename(_state, _index));
+            return ret;
+        }
 
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
+        //returns the zero based element index for the one based lua index at _index
+        inline stick::Size checkBufferIndex(lua_State * _state, const BufferData & _buffer, stick::Int32 _index)
         {
-            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
-            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+            lua_Integer idx;
+            if (!toArrayNumber(_state, _index, idx))
+                luaL_error(_state, "Buffer index has to be an integer, got %s", luaL_typename(_state, _index));
+            if (idx < 1 || static_cast<stick::Size>(idx) > _buffer.m_count)
+                luaL_error(_state, "Buffer index %d out of range [1, %d]", static_cast<int>(idx), static_cast<int>(_buffer.m_count));
+            return static_cast<stick::Size>(idx - 1);
         }
 
-        static stick::String signatureStr()
+        template<class T>
+        inline void pushBufferElement(lua_State * _state, const BufferData & _buffer, stick::Size _i)
         {
-            return SignatureName<Args...>::name();
+            pushArrayNumber(_state, static_cast<const T *>(_buffer.m_data)[_i]);
         }
 
-        static stick::Size argCount()
+        //the element is left untouched if the value at _index can't be converted
+        template<class T>
+        inline void setBufferElement(lua_State * _state, stick::Int32 _index, const BufferData & _buffer, stick::Size _i)
         {
-            return sizeof...(Args);
+            if (toArrayNumber(_state, _index, static_cast<T *>(_buffer.m_data)[_i]))
+                return;
+            if (std::is_integral<T>::value)
+                luaL_error(_state, "Integer expected to write to buffer, got %s",
+                           lua_type(_state, _index) == LUA_TNUMBER ? "non integral number" : luaL_typename(_state, _index));
+            luaL_error(_state, "Number expected to write to buffer, got %s", luaL_typename(_state, _index));
         }
 
-        static stick::Int32 func(lua_State * _luaState)
+        static stick::Int32 bufferIndex(lua_State * _state)
         {
-            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+            const BufferData & buf = *static_cast<BufferData *>(lua_touserdata(_state, 1));
+            stick::Size i = checkBufferIndex(_state, buf, 2);
+            switch (buf.m_elementType)
+            {
+            case BufferElementType::Int8: pushBufferElement<stick::Int8>(_state, buf, i); break;
+            case BufferElementType::UInt8: pushBufferElement<stick::UInt8>(_state, buf, i); break;
+            case BufferElementType::Int16: pushBufferElement<stick::Int16>(_state, buf, i); break;
+            case BufferElementType::UInt16: pushBufferElement<stick::UInt16>(_state, buf, i); break;
+            case BufferElementType::Int32: pushBufferElement<stick::Int32>(_state, buf, i); break;
+            case BufferElementType::UInt32: pushBufferElement<stick::UInt32>(_state, buf, i); break;
+            case BufferElementType::Int64: pushBufferElement<stick::Int64>(_state, buf, i); break;
+            case BufferElementType::UInt64: pushBufferElement<stick::UInt64>(_state, buf, i); break;
+            case BufferElementType::Float32: pushBufferElement<stick::Float32>(_state, buf, i); break;
+            case BufferElementType::Float64: pushBufferElement<stick::Float64>(_state, buf, i); break;
+            }
+            return 1;
         }
 
-        template<std::size_t...N>
-        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        static stick::Int32 bufferNewIndex(lua_State * _state)
         {
-            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
-            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
-            using Policy = typename GetPolicy<ph::Result, NoPolicy, Policies...>::Policy;
-            return Pusher<Ret>::push(_luaState, (obj->*Func)(convert<Args>(_luaState, 2 + N)...), Policy());
+            const BufferData & buf = *static_cast<BufferData *>(lua_touserdata(_state, 1));
+            if (buf.m_bReadOnly)
+                luaL_error(_state, "Attempt to write to a read only buffer");
+            stick::Size i = checkBufferIndex(_state, buf, 2);
+            switch (buf.m_elementType)
+            {
+            case BufferElementType::Int8: setBufferElement<stick::Int8>(_state, 3, buf, i); break;
+            case BufferElementType::UInt8: setBufferElement<stick::UInt8>(_state, 3, buf, i); break;
+            case BufferElementType::Int16: setBufferElement<stick::Int16>(_state, 3, buf, i); break;
+            case BufferElementType::UInt16: setBufferElement<stick::UInt16>(_state, 3, buf, i); break;
+            case BufferElementType::Int32: setBufferElement<stick::Int32>(_state, 3, buf, i); break;
+            case BufferElementType::UInt32: setBufferElement<stick::UInt32>(_state, 3, buf, i); break;
+            case BufferElementType::Int64: setBufferElement<stick::Int64>(_state, 3, buf, i); break;
+            case BufferElementType::UInt64: setBufferElement<stick::UInt64>(_state, 3, buf, i); break;
+            case BufferElementType::Float32: setBufferElement<stick::Float32>(_state, 3, buf, i); break;
+            case BufferElementType::Float64: setBufferElement<stick::Float64>(_state, 3, buf, i); break;
+            }
+            return 0;
         }
-                };
 
-        template <class C, class... Args, void (C::*Func)(Args...), class...Policies>
-        struct FunctionWrapper<void (C::*)(Args...), Func, Policies...>
-        {
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
+        static stick::Int32 bufferLength(lua_State * _state)
         {
-            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
-            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+            const BufferData & buf = *static_cast<BufferData *>(lua_touserdata(_state, 1));
+            lua_pushinteger(_state, static_cast<lua_Integer>(buf.m_count));
+            return 1;
         }
 
-        static stick::String signatureStr()
+        //creates the metatable shared by all buffers, called from initialize
+        inline void registerBufferMetatable(lua_State * _state, LuanaticState & _luanaticState)
         {
-            return SignatureName<Args...>::name();
+            lua_newtable(_state);
+            lua_pushcfunction(_state, bufferIndex);
+            lua_setfield(_state, -2, "__index");
+            lua_pushcfunction(_state, bufferNewIndex);
+            lua_setfield(_state, -2, "__newindex");
+            lua_pushcfunction(_state, bufferLength);
+            lua_setfield(_state, -2, "__len");
+            //the metamethods trust that they are called with a buffer, so hide them from scripts
+            lua_pushliteral(_state, "Buffer");
+            lua_setfield(_state, -2, "__metatable");
+            _luanaticState.m_bufferMetatableRef = luaL_ref(_state, LUA_REGISTRYINDEX);
+        }
+
+        inline void pushBuffer(lua_State * _state, void * _data, stick::Size _count,
+                               BufferElementType _elementType, bool _bReadOnly)
+        {
+            LuanaticState * ls = luanaticState(_state);
+            STICK_ASSERT(ls != nullptr);
+            BufferData * buf = static_cast<BufferData *>(lua_newuserdata(_state, sizeof(BufferData)));
+            buf->m_data = _data;
+            buf->m_count = _count;
+            buf->m_elementType = _elementType;
+            buf->m_bReadOnly = _bReadOnly;
+            lua_rawgeti(_state, LUA_REGISTRYINDEX, ls->m_bufferMetatableRef);
+            lua_setmetatable(_state, -2);
         }
+    }
 
-        static stick::Size argCount()
+    template<class T>
+    inline void pushBuffer(lua_State * _state, T * _data, stick::Size _count)
+    {
+        detail::pushBuffer(_state, _data, _count, BufferElementTypeOf<T>::value, false);
+    }
+
+    template<class T>
+    inline void pushBuffer(lua_State * _state, const T * _data, stick::Size _count)
+    {
+        detail::pushBuffer(_state, const_cast<T *>(_data), _count, BufferElementTypeOf<T>::value, true);
+    }
+
+    //pushes a container of contiguous numbers (i.e. stick::DynamicArray<Float32>) as a buffer
+    //instead of copying it to a table. Only use it for functions that return a reference or
+    //pointer to a container that outlives the buffer, by value results don't compile.
+    //Const containers are read only in lua.
+    template<class G>
+    struct ReturnBuffer
+    {
+        using Target = G;
+
+        template<class T>
+        stick::Int32 push(lua_State * _luaState, const T & _container) const
         {
-            return sizeof...(Args);
+            pushBuffer(_luaState, _container.ptr(), _container.count());
+            return 1;
         }
 
-        static stick::Int32 func(lua_State * _luaState)
+        template<class T>
+        stick::Int32 push(lua_State * _luaState, T * _container) const
         {
-            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+            if (!_container)
+                lua_pushnil(_luaState);
+            else
+                pushBuffer(_luaState, _container->ptr(), _container->count());
+            return 1;
         }
 
-        template<std::size_t...N>
-        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        template<class T>
+        stick::Int32 push(lua_State * _luaState, const T * _container) const
         {
-            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
-            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
-            (obj->*Func)(convert<Args>(_luaState, 2 + N)...);
-            return 0;
+            if (!_container)
+                lua_pushnil(_luaState);
+            else
+                pushBuffer(_luaState, _container->ptr(), _container->count());
+            return 1;
         }
-                };
+    };
 
-        template <class C, class... Args, void (C::*Func)(Args...) const, class...Policies>
-        struct FunctionWrapper<void (C::*)(Args...) const, Func, Policies...>
-        {
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
+    namespace detail
+    {
+        //converting a floating point value that is out of range (or nan) to an integer is undefined,
+        //so the value is saturated to the range of T instead
+        template<class T>
+        inline T saturateFloat64(stick::Float64 _value, std::true_type)
         {
-            *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount - 1);
-            return ArgScore<Args...>::score(_luaState, _argCount - 1, 1, _defaultArgCount);
+            if (!(_value > static_cast<stick::Float64>(std::numeric_limits<T>::lowest())))
+                return std::numeric_limits<T>::lowest();
+            if (_value >= static_cast<stick::Float64>(std::numeric_limits<T>::max()))
+                return std::numeric_limits<T>::max();
+            return static_cast<T>(_value);
         }
 
-        static stick::String signatureStr()
+        template<class T>
+        inline T saturateFloat64(stick::Float64 _value, std::false_type)
         {
-            return SignatureName<Args...>::name();
+            return static_cast<T>(_value);
         }
 
-        static stick::Size argCount()
+        //the type integral arithmetic is done in so that it wraps around like lua integers instead of
+        //overflowing (which is undefined for signed types, and for unsigned types narrower than int
+        //that get promoted to int).
+        template<class T, bool IsIntegral = std::is_integral<T>::value>
+        struct WrappingType
         {
-            return sizeof...(Args);
-        }
+            using Type = T;
+        };
 
-        static stick::Int32 func(lua_State * _luaState)
+        template<class T>
+        struct WrappingType<T, true>
         {
-            return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
-        }
+            using Type = typename std::make_unsigned<typename std::common_type<T, unsigned int>::type>::type;
+        };
 
-        template<std::size_t...N>
-        static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
+        //the element wise kernels behind luanatic.simd. All pointers have _count elements, _dst
+        //may alias the inputs. Integral types accumulate sum and dot in 64 bit and wrap on overflow.
+        template<class T>
+        struct ScalarKernels
         {
-            checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), -1); // - 1 for self
-            C * obj = convertToTypeAndCheck<typename RawType<C>::Type>(_luaState, 1);
-            (obj->*Func)(convert<Args>(_luaState, 2 + N)...);
-            return 0;
-        }
-                };
+            using Accumulator = typename std::conditional<std::is_floating_point<T>::value, T,
+                  typename std::conditional<std::is_signed<T>::value, stick::Int64, stick::UInt64>::type>::type;
+            using W = typename WrappingType<T>::Type;
+            using WAccumulator = typename WrappingType<Accumulator>::Type;
 
-        template <class T, T Attr>
-        struct AttributeWrapper;
+            static void add(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = static_cast<T>(static_cast<W>(_a[i]) + static_cast<W>(_b[i]));
+            }
 
-        template <class Ret, class C, Ret * C::*Member>
-        struct AttributeWrapper<Ret * C::*, Member>
-        {
-            static stick::Int32 func(lua_State * _luaState)
+            static void mul(T * _dst, const T * _a, const T * _b, stick::Size _count)
             {
-                C * obj = convertToTypeAndCheck<C>(_luaState, 1);
-                if (lua_gettop(_luaState) == 1)
-                {
-                    //no arguments, so get
-                    push<typename RawType<Ret>::Type>(_luaState, obj->*Member, false);
-                    return 1;
-                }
-                else
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = static_cast<T>(static_cast<W>(_a[i]) * static_cast<W>(_b[i]));
+            }
+
+            static void fma(T * _dst, const T * _a, const T * _b, const T * _c, stick::Size _count)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = static_cast<T>(static_cast<W>(_a[i]) * static_cast<W>(_b[i]) + static_cast<W>(_c[i]));
+            }
+
+            static void scale(T * _dst, const T * _a, T _s, stick::Size _count)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = static_cast<T>(static_cast<W>(_a[i]) * static_cast<W>(_s));
+            }
+
+            static void min(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = _b[i] < _a[i] ? _b[i] : _a[i];
+            }
+
+            static void max(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = _a[i] < _b[i] ? _b[i] : _a[i];
+            }
+
+            static void lerp(T * _dst, const T * _a, const T * _b, stick::Float64 _t, stick::Size _count)
+            {
+                lerp(_dst, _a, _b, _t, _count, std::is_integral<T>());
+            }
+
+            //integral types are computed in Float64 since b - a wraps for unsigned types
+            static void lerp(T * _dst, const T * _a, const T * _b, stick::Float64 _t, stick::Size _count, std::true_type)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
                 {
-                    //there is an arugment on the stack, so set.
-                    obj->*Member = convertToTypeAndCheck<typename RawType<Ret>::Type>(_luaState, 2);
-                    return 0;
+                    stick::Float64 a = static_cast<stick::Float64>(_a[i]);
+                    stick::Float64 b = static_cast<stick::Float64>(_b[i]);
+                    _dst[i] = saturateFloat64<T>(a + (b - a) * _t, std::true_type());
                 }
             }
+
+            //floating point types are computed in T, same as the vector kernels do for their body
+            static void lerp(T * _dst, const T * _a, const T * _b, stick::Float64 _t, stick::Size _count, std::false_type)
+            {
+                T t = static_cast<T>(_t);
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = _a[i] + (_b[i] - _a[i]) * t;
+            }
+
+            static void clamp(T * _dst, const T * _a, T _lo, T _hi, stick::Size _count)
+            {
+                for (stick::Size i = 0; i < _count; ++i)
+                    _dst[i] = _a[i] < _lo ? _lo : _hi < _a[i] ? _hi : _a[i];
+            }
+
+            static Accumulator sum(const T * _a, stick::Size _count)
+            {
+                WAccumulator ret = 0;
+                for (stick::Size i = 0; i < _count; ++i)
+                    ret += static_cast<WAccumulator>(static_cast<Accumulator>(_a[i]));
+                return static_cast<Accumulator>(ret);
+            }
+
+            static Accumulator dot(const T * _a, const T * _b, stick::Size _count)
+            {
+                WAccumulator ret = 0;
+                for (stick::Size i = 0; i < _count; ++i)
+                    ret += static_cast<WAccumulator>(static_cast<Accumulator>(_a[i])) *
+                           static_cast<WAccumulator>(static_cast<Accumulator>(_b[i]));
+                return static_cast<Accumulator>(ret);
+            }
         };
 
-        template<class T, class Enable = void>
-        struct AttributePusher
-        {
-            static void push(lua_State * _luaState, T & _val)
+#if defined(LUANATIC_USE_AVX) || defined(LUANATIC_USE_SSE)
+        //thin wrappers around the intrinsics of one register type, used by VectorKernels
+#ifdef LUANATIC_USE_AVX
+        struct Float32Register
+        {
+            using Register = __m256;
+            static constexpr stick::Size width = 8;
+            static Register load(const stick::Float32 * _ptr) { return _mm256_loadu_ps(_ptr); }
+            static void store(stick::Float32 * _ptr, Register _r) { _mm256_storeu_ps(_ptr, _r); }
+            static Register set(stick::Float32 _v) { return _mm256_set1_ps(_v); }
+            static Register add(Register _a, Register _b) { return _mm256_add_ps(_a, _b); }
+            static Register sub(Register _a, Register _b) { return _mm256_sub_ps(_a, _b); }
+            static Register mul(Register _a, Register _b) { return _mm256_mul_ps(_a, _b); }
+            static Register min(Register _a, Register _b) { return _mm256_min_ps(_b, _a); }
+            static Register max(Register _a, Register _b) { return _mm256_max_ps(_b, _a); }
+#ifdef __FMA__
+            static Register fma(Register _a, Register _b, Register _c) { return _mm256_fmadd_ps(_a, _b, _c); }
+#else
+            static Register fma(Register _a, Register _b, Register _c) { return _mm256_add_ps(_mm256_mul_ps(_a, _b), _c); }
+#endif //__FMA__
+            static stick::Float32 horizontalSum(Register _r)
             {
-                luanatic::push(_luaState, &_val, false);
+                alignas(32) stick::Float32 v[width];
+                _mm256_store_ps(v, _r);
+                return ((v[0] + v[1]) + (v[2] + v[3])) + ((v[4] + v[5]) + (v[6] + v[7]));
             }
         };
 
-        template<class T>
-        struct AttributePusher < T, typename std::enable_if < std::is_integral<T>::value || std::is_enum<T>::value || std::is_floating_point<T>::value >::type >
-        {
-            static void push(lua_State * _luaState, T & _val)
+        struct Float64Register
+        {
+            using Register = __m256d;
+            static constexpr stick::Size width = 4;
+            static Register load(const stick::Float64 * _ptr) { return _mm256_loadu_pd(_ptr); }
+            static void store(stick::Float64 * _ptr, Register _r) { _mm256_storeu_pd(_ptr, _r); }
+            static Register set(stick::Float64 _v) { return _mm256_set1_pd(_v); }
+            static Register add(Register _a, Register _b) { return _mm256_add_pd(_a, _b); }
+            static Register sub(Register _a, Register _b) { return _mm256_sub_pd(_a, _b); }
+            static Register mul(Register _a, Register _b) { return _mm256_mul_pd(_a, _b); }
+            static Register min(Register _a, Register _b) { return _mm256_min_pd(_b, _a); }
+            static Register max(Register _a, Register _b) { return _mm256_max_pd(_b, _a); }
+#ifdef __FMA__
+            static Register fma(Register _a, Register _b, Register _c) { return _mm256_fmadd_pd(_a, _b, _c); }
+#else
+            static Register fma(Register _a, Register _b, Register _c) { return _mm256_add_pd(_mm256_mul_pd(_a, _b), _c); }
+#endif //__FMA__
+            static stick::Float64 horizontalSum(Register _r)
             {
-                luanatic::pushValueType(_luaState, _val);
+                alignas(32) stick::Float64 v[width];
+                _mm256_store_pd(v, _r);
+                return (v[0] + v[1]) + (v[2] + v[3]);
+            }
+        };
+#else
+        struct Float32Register
+        {
+            using Register = __m128;
+            static constexpr stick::Size width = 4;
+            static Register load(const stick::Float32 * _ptr) { return _mm_loadu_ps(_ptr); }
+            static void store(stick::Float32 * _ptr, Register _r) { _mm_storeu_ps(_ptr, _r); }
+            static Register set(stick::Float32 _v) { return _mm_set1_ps(_v); }
+            static Register add(Register _a, Register _b) { return _mm_add_ps(_a, _b); }
+            static Register sub(Register _a, Register _b) { return _mm_sub_ps(_a, _b); }
+            static Register mul(Register _a, Register _b) { return _mm_mul_ps(_a, _b); }
+            static Register min(Register _a, Register _b) { return _mm_min_ps(_b, _a); }
+            static Register max(Register _a, Register _b) { return _mm_max_ps(_b, _a); }
+            static Register fma(Register _a, Register _b, Register _c) { return _mm_add_ps(_mm_mul_ps(_a, _b), _c); }
+            static stick::Float32 horizontalSum(Register _r)
+            {
+                alignas(16) stick::Float32 v[width];
+                _mm_store_ps(v, _r);
+                return (v[0] + v[1]) + (v[2] + v[3]);
             }
         };
 
-        template <class Ret, class C, Ret C::*Member>
-        struct AttributeWrapper <Ret C::*, Member>
+        struct Float64Register
+        {
+            using Register = __m128d;
+            static constexpr stick::Size width = 2;
+            static Register load(const stick::Float64 * _ptr) { return _mm_loadu_pd(_ptr); }
+            static void store(stick::Float64 * _ptr, Register _r) { _mm_storeu_pd(_ptr, _r); }
+            static Register set(stick::Float64 _v) { return _mm_set1_pd(_v); }
+            static Register add(Register _a, Register _b) { return _mm_add_pd(_a, _b); }
+            static Register sub(Register _a, Register _b) { return _mm_sub_pd(_a, _b); }
+            static Register mul(Register _a, Register _b) { return _mm_mul_pd(_a, _b); }
+            static Register min(Register _a, Register _b) { return _mm_min_pd(_b, _a); }
+            static Register max(Register _a, Register _b) { return _mm_max_pd(_b, _a); }
+            static Register fma(Register _a, Register _b, Register _c) { return _mm_add_pd(_mm_mul_pd(_a, _b), _c); }
+            static stick::Float64 horizontalSum(Register _r)
+            {
+                alignas(16) stick::Float64 v[width];
+                _mm_store_pd(v, _r);
+                return v[0] + v[1];
+            }
+        };
+#endif //LUANATIC_USE_AVX
+
+        //same as ScalarKernels, processing R::width elements at once and the rest with ScalarKernels.
+        //min and max pass their operands to the intrinsics swapped, so that they pick the same
+        //operand as the scalar version if one of them is NaN.
+        template<class T, class R>
+        struct VectorKernels
         {
-            static stick::Int32 func(lua_State * _luaState)
+            using Accumulator = T;
+            using Scalar = ScalarKernels<T>;
+            using Register = typename R::Register;
+
+            static stick::Size vectorCount(stick::Size _count)
             {
-                C * obj = convertToTypeAndCheck<C>(_luaState, 1);
-                if (lua_gettop(_luaState) == 1)
-                {
-                    AttributePusher<Ret>::push(_luaState, obj->*Member);
-                    return 1;
-                }
-                else
+                return _count - _count % R::width;
+            }
+
+            static void add(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::add(R::load(_a + i), R::load(_b + i)));
+                Scalar::add(_dst + n, _a + n, _b + n, _count - n);
+            }
+
+            static void mul(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::mul(R::load(_a + i), R::load(_b + i)));
+                Scalar::mul(_dst + n, _a + n, _b + n, _count - n);
+            }
+
+            static void fma(T * _dst, const T * _a, const T * _b, const T * _c, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::fma(R::load(_a + i), R::load(_b + i), R::load(_c + i)));
+                Scalar::fma(_dst + n, _a + n, _b + n, _c + n, _count - n);
+            }
+
+            static void scale(T * _dst, const T * _a, T _s, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                Register s = R::set(_s);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::mul(R::load(_a + i), s));
+                Scalar::scale(_dst + n, _a + n, _s, _count - n);
+            }
+
+            static void min(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::min(R::load(_a + i), R::load(_b + i)));
+                Scalar::min(_dst + n, _a + n, _b + n, _count - n);
+            }
+
+            static void max(T * _dst, const T * _a, const T * _b, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::max(R::load(_a + i), R::load(_b + i)));
+                Scalar::max(_dst + n, _a + n, _b + n, _count - n);
+            }
+
+            static void lerp(T * _dst, const T * _a, const T * _b, stick::Float64 _t, stick::Size _count)
+            {
+                stick::Size n = vectorCount(_count);
+                Register t = R::set(static_cast<T>(_t));
+                for (stick::Size i = 0; i < n; i += R::width)
                 {
-                    obj->*Member = convertToValueTypeAndCheck<Ret>(_luaState, 2);
-                    return 0;
+                    Register a = R::load(_a + i);
+                    R::store(_dst + i, R::add(a, R::mul(R::sub(R::load(_b + i), a), t)));
                 }
+                Scalar::lerp(_dst + n, _a + n, _b + n, _t, _count - n);
             }
-        };
 
-        template <class T, class... Args>
-        struct ConstructorWrapper
-        {
-            static stick::Int32 score(lua_State * _luaState,
-                                      stick::Int32 _argCount,
-                                      stick::Int32 _defaultArgCount,
-                                      stick::Int32 * _outDefaultArgsNeeded)
+            static void clamp(T * _dst, const T * _a, T _lo, T _hi, stick::Size _count)
             {
-                *_outDefaultArgsNeeded = sizeof...(Args) - (_argCount);
-                return ArgScore<Args...>::score(_luaState, _argCount, 0, _defaultArgCount);
+                stick::Size n = vectorCount(_count);
+                Register lo = R::set(_lo);
+                Register hi = R::set(_hi);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    R::store(_dst + i, R::min(R::max(R::load(_a + i), lo), hi));
+                Scalar::clamp(_dst + n, _a + n, _lo, _hi, _count - n);
             }
 
-            static stick::String signatureStr()
+            static T sum(const T * _a, stick::Size _count)
             {
-                return SignatureName<Args...>::name();
+                stick::Size n = vectorCount(_count);
+                Register acc = R::set(0);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    acc = R::add(acc, R::load(_a + i));
+                return R::horizontalSum(acc) + Scalar::sum(_a + n, _count - n);
             }
 
-            //this function serves to have an extra step between converting the arguments
-            //from lua, so that in case of an error, we don't leak the newly created T obj
-            static T * create(LuanaticState * _state, Args... _args)
+            static T dot(const T * _a, const T * _b, stick::Size _count)
             {
-                return _state->m_allocator->create<T>(std::forward<Args>(_args)...);
+                stick::Size n = vectorCount(_count);
+                Register acc = R::set(0);
+                for (stick::Size i = 0; i < n; i += R::width)
+                    acc = R::fma(R::load(_a + i), R::load(_b + i), acc);
+                return R::horizontalSum(acc) + Scalar::dot(_a + n, _b + n, _count - n);
             }
+        };
+#endif //defined(LUANATIC_USE_AVX) || defined(LUANATIC_USE_SSE)
 
+        template<class T>
+        struct BufferKernels : public ScalarKernels<T> {};
 
-            static stick::Int32 func(lua_State * _luaState)
-            {
-                return funcImpl(_luaState, make_index_sequence<sizeof...(Args)>());
+#if defined(LUANATIC_USE_AVX) || defined(LUANATIC_USE_SSE)
+        template<>
+        struct BufferKernels<stick::Float32> : public VectorKernels<stick::Float32, Float32Register> {};
+
+        template<>
+        struct BufferKernels<stick::Float64> : public VectorKernels<stick::Float64, Float64Register> {};
+#endif //defined(LUANATIC_USE_AVX) || defined(LUANATIC_USE_SSE)
+
+        //calls Op::template apply<T> with the C++ type of _type
+        template<class Op, class...Args>
+        inline stick::Int32 dispatchBufferType(BufferElementType _type, Args && ... _args)
+        {
+            switch (_type)
+            {
+            case BufferElementType::Int8: return Op::template apply<stick::Int8>(std::forward<Args>(_args)...);
+            case BufferElementType::UInt8: return Op::template apply<stick::UInt8>(std::forward<Args>(_args)...);
+            case BufferElementType::Int16: return Op::template apply<stick::Int16>(std::forward<Args>(_args)...);
+            case BufferElementType::UInt16: return Op::template apply<stick::UInt16>(std::forward<Args>(_args)...);
+            case BufferElementType::Int32: return Op::template apply<stick::Int32>(std::forward<Args>(_args)...);
+            case BufferElementType::UInt32: return Op::template apply<stick::UInt32>(std::forward<Args>(_args)...);
+            case BufferElementType::Int64: return Op::template apply<stick::Int64>(std::forward<Args>(_args)...);
+            case BufferElementType::UInt64: return Op::template apply<stick::UInt64>(std::forward<Args>(_args)...);
+            case BufferElementType::Float32: return Op::template apply<stick::Float32>(std::forward<Args>(_args)...);
+            case BufferElementType::Float64: return Op::template apply<stick::Float64>(std::forward<Args>(_args)...);
             }
+            return 0;
+        }
 
-            template<std::size_t...N>
-            static stick::Int32 funcImpl(lua_State * _luaState, index_sequence<N...>)
-            {
-                LuanaticState * glua = luanaticState(_luaState);
-                STICK_ASSERT(glua != nullptr);
+        inline BufferData * checkWritableBuffer(lua_State * _state, stick::Int32 _index)
+        {
+            BufferData * ret = checkBuffer(_state, _index);
+            if (ret->m_bReadOnly)
+                luaErrorWithStackTrace(_state, _index, "Writable buffer expected");
+            return ret;
+        }
 
-                checkArgumentCountAndEmitLuaError(_luaState, sizeof...(Args), 0);
+        //checks that the buffer at _index has the same element type and count as _buffer
+        inline BufferData * checkMatchingBuffer(lua_State * _state, stick::Int32 _index, const BufferData & _buffer)
+        {
+            BufferData * ret = checkBuffer(_state, _index);
+            if (ret->m_elementType != _buffer.m_elementType || ret->m_count != _buffer.m_count)
+                luaErrorWithStackTrace(_state, _index, "Buffer of the same element type and length expected");
+            return ret;
+        }
+
+        template<class T>
+        inline T checkBufferScalar(lua_State * _state, stick::Int32 _index)
+        {
+            T ret;
+            if (!toArrayNumber(_state, _index, ret))
+                luaErrorWithStackTrace(_state, _index, "Number expected, got %s", luaL_typename(_state, _index));
+            return ret;
+        }
 
-                T * obj = create(glua, convert<Args>(_luaState, 1 + N)...);
+        template<class T>
+        inline T * bufferPtr(const BufferData * _buffer)
+        {
+            return static_cast<T *>(_buffer->m_data);
+        }
 
-                if (obj)
-                {
-                    push<T>(_luaState, obj, true);
-                    return 1;
-                }
+        //simd.add(dst, a, b) and friends: dst[i] = a[i] op b[i]
+        struct SimdBinaryOp
+        {
+            enum Kind { Add, Mul, Min, Max };
 
+            template<class T>
+            static stick::Int32 apply(Kind _kind, BufferData * _dst, BufferData * _a, BufferData * _b)
+            {
+                using K = BufferKernels<T>;
+                auto fn = _kind == Add ? K::add : _kind == Mul ? K::mul : _kind == Min ? K::min : K::max;
+                fn(bufferPtr<T>(_dst), bufferPtr<T>(_a), bufferPtr<T>(_b), _dst->m_count);
                 return 0;
             }
         };
 
-        template<class Iterator, bool ForceReference>
-        struct IterValuePusher;
+        template<SimdBinaryOp::Kind K>
+        static stick::Int32 simdBinary(lua_State * _state)
+        {
+            BufferData * dst = checkWritableBuffer(_state, 1);
+            BufferData * a = checkMatchingBuffer(_state, 2, *dst);
+            BufferData * b = checkMatchingBuffer(_state, 3, *dst);
+            return dispatchBufferType<SimdBinaryOp>(dst->m_elementType, K, dst, a, b);
+        }
 
-        template<class Iterator>
-        struct IterValuePusher<Iterator, true>
+        //simd.fma(dst, a, b, c): dst[i] = a[i] * b[i] + c[i]
+        struct SimdFmaOp
         {
-            static void push(lua_State * _luaState, Iterator * _it)
+            template<class T>
+            static stick::Int32 apply(BufferData * _dst, BufferData * _a, BufferData * _b, BufferData * _c)
             {
-                typedef typename stick::IteratorTraits<Iterator>::ValueType ValueType;
-                Pusher<ValueType &>::push(_luaState, **_it, detail::NoPolicy());
+                BufferKernels<T>::fma(bufferPtr<T>(_dst), bufferPtr<T>(_a), bufferPtr<T>(_b), bufferPtr<T>(_c), _dst->m_count);
+                return 0;
             }
         };
 
-        template<class Iterator>
-        struct IterValuePusher<Iterator, false>
+        static stick::Int32 simdFma(lua_State * _state)
         {
-            static void push(lua_State * _luaState, Iterator * _it)
+            BufferData * dst = checkWritableBuffer(_state, 1);
+            BufferData * a = checkMatchingBuffer(_state, 2, *dst);
+            BufferData * b = checkMatchingBuffer(_state, 3, *dst);
+            BufferData * c = checkMatchingBuffer(_state, 4, *dst);
+            return dispatchBufferType<SimdFmaOp>(dst->m_elementType, dst, a, b, c);
+        }
+
+        //simd.scale(dst, a, s): dst[i] = a[i] * s
+        struct SimdScaleOp
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _state, BufferData * _dst, BufferData * _a)
             {
-                typedef typename stick::IteratorTraits<Iterator>::ValueType ValueType;
-                Pusher<ValueType>::push(_luaState, **_it, detail::NoPolicy());
+                BufferKernels<T>::scale(bufferPtr<T>(_dst), bufferPtr<T>(_a), checkBufferScalar<T>(_state, 3), _dst->m_count);
+                return 0;
             }
         };
 
-        template<class Iterator, bool ForceReference>
-        stick::Int32 iteratorFunction(lua_State * _luaState)
+        static stick::Int32 simdScale(lua_State * _state)
         {
-            Iterator * iter = static_cast<Iterator *>(lua_touserdata(_luaState, lua_upvalueindex(1)));
-            Iterator * end = static_cast<Iterator *>(lua_touserdata(_luaState, lua_upvalueindex(2)));
+            BufferData * dst = checkWritableBuffer(_state, 1);
+            BufferData * a = checkMatchingBuffer(_state, 2, *dst);
+            return dispatchBufferType<SimdScaleOp>(dst->m_elementType, _state, dst, a);
+        }
 
-            if (iter && end)
-            {
-                if (*iter != *end)
-                {
-                    //push the current iterator value and advance
-                    IterValuePusher<Iterator, ForceReference>::push(_luaState, iter);
-                    ++(*iter);
-                }
-                else
-                {
-                    //we reached the end
-                    lua_pushnil(_luaState);
-                }
-            }
-            else
+        //simd.lerp(dst, a, b, t): dst[i] = a[i] + (b[i] - a[i]) * t
+        struct SimdLerpOp
+        {
+            template<class T>
+            static stick::Int32 apply(BufferData * _dst, BufferData * _a, BufferData * _b, stick::Float64 _t)
             {
-                //emit error
-                lua_pushstring(_luaState, "Invalid c++ iterator pair");
-                lua_error(_luaState);
+                BufferKernels<T>::lerp(bufferPtr<T>(_dst), bufferPtr<T>(_a), bufferPtr<T>(_b), _t, _dst->m_count);
+                return 0;
             }
+        };
 
-            return 1;
+        static stick::Int32 simdLerp(lua_State * _state)
+        {
+            BufferData * dst = checkWritableBuffer(_state, 1);
+            BufferData * a = checkMatchingBuffer(_state, 2, *dst);
+            BufferData * b = checkMatchingBuffer(_state, 3, *dst);
+            stick::Float64 t = luaL_checknumber(_state, 4);
+            return dispatchBufferType<SimdLerpOp>(dst->m_elementType, dst, a, b, t);
         }
 
-        template<class Iterator, bool ForceReference>
-        struct RangeFunctionPusher;
-
-        template<class Iterator>
-        struct RangeFunctionPusher<Iterator, true>
+        //simd.clamp(dst, a, lo, hi): dst[i] = min(max(a[i], lo), hi)
+        struct SimdClampOp
         {
-            static void push(lua_State * _luaState)
-            {
-                lua_pushcclosure(_luaState, iteratorFunction<Iterator, true>, 2);
+            template<class T>
+            static stick::Int32 apply(lua_State * _state, BufferData * _dst, BufferData * _a)
+            {
+                T lo = checkBufferScalar<T>(_state, 3);
+                T hi = checkBufferScalar<T>(_state, 4);
+                //the vector and scalar kernels would disagree about an empty range
+                if (hi < lo)
+                    luaL_error(_state, "Lower clamp bound is greater than the upper bound");
+                BufferKernels<T>::clamp(bufferPtr<T>(_dst), bufferPtr<T>(_a), lo, hi, _dst->m_count);
+                return 0;
             }
         };
 
-        template<class Iterator>
-        struct RangeFunctionPusher<Iterator, false>
+        static stick::Int32 simdClamp(lua_State * _state)
         {
-            static void push(lua_State * _luaState)
+            BufferData * dst = checkWritableBuffer(_state, 1);
+            BufferData * a = checkMatchingBuffer(_state, 2, *dst);
+            return dispatchBufferType<SimdClampOp>(dst->m_elementType, _state, dst, a);
+        }
+
+        //simd.sum(a) and simd.dot(a, b)
+        struct SimdReduceOp
+        {
+            template<class T>
+            static stick::Int32 apply(lua_State * _state, BufferData * _a, BufferData * _b)
             {
-                lua_pushcclosure(_luaState, iteratorFunction<Iterator, false>, 2);
+                if (_b)
+                    pushArrayNumber(_state, BufferKernels<T>::dot(bufferPtr<T>(_a), bufferPtr<T>(_b), _a->m_count));
+                else
+                    pushArrayNumber(_state, BufferKernels<T>::sum(bufferPtr<T>(_a), _a->m_count));
+                return 1;
             }
         };
 
-        template<bool ForceReference, class Iterator>
-        inline stick::Int32 pushRange(lua_State * _luaState, Iterator _begin, Iterator _end)
+        static stick::Int32 simdSum(lua_State * _state)
         {
-            pushUnregisteredType<Iterator>(_luaState, _begin);
-            pushUnregisteredType<Iterator>(_luaState, _end);
-            RangeFunctionPusher<Iterator, ForceReference>::push(_luaState);
-            return 1;
+            BufferData * a = checkBuffer(_state, 1);
+            return dispatchBufferType<SimdReduceOp>(a->m_elementType, _state, a, static_cast<BufferData *>(nullptr));
         }
 
-        template<class T>
-        int _push(lua_State * _luaState, stick::Int32 _startIdx, stick::Int32 _idx, T _value)
+        static stick::Int32 simdDot(lua_State * _state)
         {
-            if (_idx >= _startIdx)
-                Pusher<T>::push(_luaState, std::forward<T>(_value), NoPolicy());
-            return 0;
+            BufferData * a = checkBuffer(_state, 1);
+            BufferData * b = checkMatchingBuffer(_state, 2, *a);
+            return dispatchBufferType<SimdReduceOp>(a->m_elementType, _state, a, b);
         }
 
-        template<class...Args>
-        struct DefaultArgs : public DefaultArgsBase
+        //simd.gather(dst, src, first, stride): dst[i] = src[first + (i - 1) * stride]
+        //simd.scatter(dst, src, first, stride): dst[first + (i - 1) * stride] = src[i]
+        struct SimdStrideOp
         {
-            DefaultArgs()
-            {
-            }
-
-            DefaultArgs(Args..._args) :
-                values(_args...)
-            {
-            }
-
-            void push(lua_State * _state, stick::Int32 _count) const final
+            template<class T>
+            static stick::Int32 apply(bool _bGather, BufferData * _dst, BufferData * _src, stick::Size _first, stick::Size _stride)
             {
-                pushHelper(_state, sizeof...(Args) - _count, make_index_sequence<sizeof...(Args)>());
+                T * dst = bufferPtr<T>(_dst);
+                const T * src = bufferPtr<T>(_src);
+                if (_bGather)
+                {
+                    for (stick::Size i = 0; i < _dst->m_count; ++i)
+                        dst[i] = src[_first + i * _stride];
+                }
+                else
+                {
+                    for (stick::Size i = 0; i < _src->m_count; ++i)
+                        dst[_first + i * _stride] = src[i];
+                }
+                return 0;
             }
+        };
 
-            stick::Size argCount() const final
-            {
-                return sizeof...(Args);
-            }
+        template<bool Gather>
+        static stick::Int32 simdStride(lua_State * _state)
+        {
+            BufferData * dst = checkWritableBuffer(_state, 1);
+            BufferData * src = checkBuffer(_state, 2);
+            if (src->m_elementType != dst->m_elementType)
+                luaErrorWithStackTrace(_state, 2, "Buffer of the same element type expected");
+            lua_Integer first = luaL_checkinteger(_state, 3);
+            lua_Integer stride = luaL_optinteger(_state, 4, 1);
+            //the strided side has to hold all elements of the contiguous side
+            const BufferData * strided = Gather ? src : dst;
+            stick::Size count = Gather ? dst->m_count : src->m_count;
+            if (first < 1 || stride < 1)
+                luaL_error(_state, "Strided range out of bounds");
+            stick::Size offset = static_cast<stick::Size>(first - 1);
+            stick::Size step = static_cast<stick::Size>(stride);
+            //offset + (count - 1) * step < m_count, checked without overflowing
+            if (count && (offset >= strided->m_count ||
+                          (count > 1 && step > (strided->m_count - 1 - offset) / (count - 1))))
+                luaL_error(_state, "Strided range out of bounds");
+            return dispatchBufferType<SimdStrideOp>(dst->m_elementType, Gather, dst, src, offset, step);
+        }
+
+        //creates the luanatic.simd table, called from initialize
+        inline void registerSimdLibrary(lua_State * _state)
+        {
+            static const luaL_Reg s_functions[] =
+            {
+                {"add", simdBinary<SimdBinaryOp::Add>},
+                {"mul", simdBinary<SimdBinaryOp::Mul>},
+                {"min", simdBinary<SimdBinaryOp::Min>},
+                {"max", simdBinary<SimdBinaryOp::Max>},
+                {"fma", simdFma},
+                {"scale", simdScale},
+                {"lerp", simdLerp},
+                {"clamp", simdClamp},
+                {"sum", simdSum},
+                {"dot", simdDot},
+                {"gather", simdStride<true>},
+                {"scatter", simdStride<false>},
+                {nullptr, nullptr}
+            };
 
-            template<stick::Size...N>
-            void pushHelper(lua_State * _state, stick::Int32 _startIdx, index_sequence<N...>) const
+            pushGlobalsTable(_state);                   // G
+            lua_getfield(_state, -1, "luanatic");       // G luanatic
+            lua_newtable(_state);                       // G luanatic simd
+            for (const luaL_Reg * reg = s_functions; reg->name; ++reg)
             {
-                int tmp[] = {_push<Args>(_state, _startIdx, N, std::get<N>(values))...};
+                lua_pushcfunction(_state, reg->func);
+                lua_setfield(_state, -2, reg->name);
             }
-
-            std::tuple<Args...> values;
-        };
-    }
-
-    template<class G>
-    struct ReturnIterator
-    {
-        using Target = G;
-
-        template<class T>
-        stick::Int32 push(lua_State * _luaState, const T & _container) const
-        {
-            return detail::pushRange<false>(_luaState, _container.begin(), _container.end());
-        }
-    };
-
-    template<class G>
-    struct ReturnRefIterator
-    {
-        using Target = G;
-
-        template<class T>
-        stick::Int32 push(lua_State * _luaState, const T & _container) const
-        {
-            return detail::pushRange<true>(_luaState, _container.begin(), _container.end());
+            lua_setfield(_state, -2, "simd");           // G luanatic
+            lua_pop(_state, 2);
         }
-    };
+    }
 
     //ClassWrapper implementation
 
@@ -3001,7 +5438,7 @@ namespace luanatic
     template <class... Args>
     ClassWrapper<T> & ClassWrapper<T>::addConstructor()
     {
-        m_constructors.append({"", {&detail::ConstructorWrapper<T, Args...>::func, &detail::ConstructorWrapper<T, Args...>::score, &detail::ConstructorWrapper<T, Args...>::signatureStr}});
+        m_constructors.append({"", {&detail::ConstructorWrapper<T, Args...>::func, &detail::ConstructorWrapper<T, Args...>::score, &detail::ConstructorWrapper<T, Args...>::signatureStr, &detail::ConstructorWrapper<T, Args...>::argCount, detail::ConstructorWrapper<T, Args...>::bShapeOnlyScore}});
         return *this;
     }
 
@@ -3009,7 +5446,7 @@ namespace luanatic
     template <class... Args>
     ClassWrapper<T> & ClassWrapper<T>::addConstructor(const stick::String & _str)
     {
-        m_statics.append({ _str, {&detail::ConstructorWrapper<T, Args...>::func, &detail::ConstructorWrapper<T, Args...>::score, &detail::ConstructorWrapper<T, Args...>::signatureStr}});
+        m_statics.append({ _str, {&detail::ConstructorWrapper<T, Args...>::func, &detail::ConstructorWrapper<T, Args...>::score, &detail::ConstructorWrapper<T, Args...>::signatureStr, &detail::ConstructorWrapper<T, Args...>::argCount, detail::ConstructorWrapper<T, Args...>::bShapeOnlyScore}});
         return *this;
     }
 
@@ -3030,6 +5467,28 @@ namespace luanatic
         return *this;
     }
 
+    template <class T>
+    ClassWrapper<T> & ClassWrapper<T>::setStorageMode(StorageMode _mode)
+    {
+        m_storageMode = _mode;
+        return *this;
+    }
+
+    template <class T>
+    ClassWrapper<T> & ClassWrapper<T>::setPoolSlabSize(stick::Size _objectCount)
+    {
+        STICK_ASSERT(_objectCount > 0);
+        m_poolSlabSize = _objectCount;
+        return *this;
+    }
+
+    template <class T>
+    ClassWrapper<T> & ClassWrapper<T>::setCacheBorrowed(bool _bCache)
+    {
+        m_bCacheBorrowed = _bCache;
+        return *this;
+    }
+
     // template <class T>
     // template <class B>
     // ClassWrapper<T> & ClassWrapper<T>::addWrapper()
@@ -3228,6 +5687,8 @@ namespace luanatic
         template <class T>
         T get()
         {
+            static_assert(!std::is_same<typename detail::RawType<T>::Type, StringView>::value,
+                          "The value is popped again, use get<stick::String>()");
             STICK_ASSERT(isValid());
             push();
             detail::StackPop popper(m_state, 1);
@@ -3322,8 +5783,8 @@ namespace luanatic
         {
             /*detail::LuanaticState * glua = detail::luanaticState(_luaState);
             STICK_ASSERT(glua != nullptr);
-            auto it = glua->m_typeIDClassMap.find(stick::TypeInfoT<A>::typeID());
-            if(it == glua->m_typeIDClassMap.end())
+            auto wc = detail::findClass(*glua, stick::TypeInfoT<A>::typeID());
+            if(!wc)
             {
 
             }*/
@@ -3348,6 +5809,10 @@ namespace luanatic
             return registerFunction(_name, {_function, NULL});
         }
 
+        //functions registered with the same name are overloads. The overload picked for a call is
+        //cached per argument shape (lua type, sign of numbers, numeric strings, userdata metatable).
+        //User specializations of detail::LuaTypeScore might look at more than that (i.e. string
+        //contents), so overloads using them are always scored unless they declare ShapeOnly.
         LuaValue & registerFunction(const stick::String & _name,
                                     LuanaticFunction _function)
         {
@@ -3510,75 +5975,87 @@ namespace luanatic
 
     namespace detail
     {
-        template <class T>
-        inline void removeStorage(lua_State * _state, const T * _obj)
+        // calls the attribute accessor on top of the stack with the first _argCount stack values
+        // as arguments, self for getters and self, value for setters.
+        inline stick::Int32 callAttribute(lua_State * _luaState, stick::Int32 _argCount)
         {
-            lua_getfield(_state, LUA_REGISTRYINDEX, LUANATIC_KEY); // glua
-            lua_getfield(_state, -1, "storage");                   // glua glua.storage
-
-            ObjectIdentifier<T>::identify(_state, _obj); // glua.storage id
-
-            lua_pushvalue(_state, -1); // glua.storage id id
-            lua_gettable(_state, -3);  // glua.storage id objOrNil
+            stick::Int32 resultCount = _argCount == 1 ? 1 : 0;
 
-            if (lua_isnil(_state, -1))
+            // C functions without upvalues (i.e. AttributeWrapper::func) can be called in place
+            // without a nested lua_call. Closures (i.e. added from lua) would see our upvalues.
+            lua_CFunction accessor = lua_tocfunction(_luaState, -1);
+            if (accessor)
             {
-                // if nil, there is nothing to invalidate
-                lua_pop(_state, 3);
-                return;
-            }
-            else
-            {
-                lua_pop(_state, 1);       // glua.storage id
-                lua_pushnil(_state);      // glua.storage id nil
-                lua_settable(_state, -3); // glua.storage
-                lua_pop(_state, 1);       //
+                if (!lua_getupvalue(_luaState, -1, 1))
+                {
+                    lua_settop(_luaState, _argCount);
+                    return accessor(_luaState);
+                }
+                lua_pop(_luaState, 1);
             }
+
+            // everything else needs its own call frame
+            lua_insert(_luaState, 1); // func args ...
+            lua_settop(_luaState, 1 + _argCount);
+            lua_call(_luaState, _argCount, resultCount);
+            return resultCount;
         }
 
         template <class T>
         inline stick::Int32 newIndex(lua_State * _luaState)
         {
-            T * obj = convertToTypeAndCheck<T>(_luaState, 1);
+            convertToTypeAndCheck<T>(_luaState, 1);
+
+            // attributes are resolved through the accessor table of the class (upvalue 1)
+            lua_pushvalue(_luaState, 2);                // obj key val key
+            lua_rawget(_luaState, lua_upvalueindex(1)); // obj key val accessorOrNil
+            if (AttributeAccessor * accessor = toAttributeAccessor(_luaState, -1))
+            {
+                lua_remove(_luaState, 2);  // obj val accessor
+                lua_settop(_luaState, 2);  // obj val
+                return accessor->function(_luaState);
+            }
+            lua_settop(_luaState, 3);      // obj key val
 
-            // first we check if this is an attribute
+            // then we check if this is an attribute that was added from lua
             lua_getmetatable(_luaState, 1); // obj key val mt
             lua_getfield(_luaState, -1, "__attributes"); // obj key val mt __attributes
             lua_pushvalue(_luaState, -4); // obj key val mt __attributes key
             lua_gettable(_luaState,
                          -2); // obj key val mt __attributes funcOrNil
 
-            // if we found it we call it
+            // if we found it we call it as setter
             if (!lua_isnil(_luaState, -1))
             {
-                // push the function arguments
-                lua_pushvalue(_luaState,  1); // obj key val mt __attributes funcOrNil obj
-                lua_pushvalue( _luaState, 3); // obj key val mt __attributes funcOrNil obj val
-                lua_call(_luaState, 2, 0);
-                return 0;
+                lua_remove(_luaState, 2); // obj val mt __attributes func
+                return callAttribute(_luaState, 2);
             }
 
-            lua_settop(_luaState, 3); // obj key val
-            lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY);             // obj key val gT
-            lua_getfield(_luaState, -1, "storage"); // obj key val gT storage
+            //the class table can't resolve dynamic fields, so make sure index<T> is used from now on
+            lua_getfield(_luaState, -3, "__index"); // obj key val mt __attributes nil mt.__index
+            if (!lua_iscfunction(_luaState, -1))
+            {
+                lua_pushvalue(_luaState, lua_upvalueindex(1));
+                lua_pushvalue(_luaState, -5);
+                lua_pushcclosure(_luaState, index<T>, 2);
+                lua_setfield(_luaState, -5, "__index");
+            }
 
-            detail::ObjectIdentifier<T>::identify(_luaState, obj); // obj key gT storage id
-            lua_pushvalue(_luaState, -1);               // obj key val gT storage id id
-            lua_gettable(_luaState, -3); // obj key val gT storage id idtableOrNil
+            lua_settop(_luaState, 3); // obj key val
 
             // Add the storage table if there isn't one already
-            if (lua_isnil(_luaState, -1))
+            UserData * userData = static_cast<UserData *>(lua_touserdata(_luaState, 1));
+            if (!userData->m_bHasStorage)
             {
-                lua_pop(_luaState, 1);        // obj key val gT storage id
-                lua_newtable(_luaState);      // obj key val gT storage id {}
-                lua_pushvalue(_luaState, -1); // obj key val gT storage id {} {}
-                lua_insert(_luaState, -3);    // obj key gT val gT storage {} id {}
-                lua_settable(_luaState, -4);  // obj key val gT storage {}
+                lua_newtable(_luaState);         // obj key val {}
+                setUserValue(_luaState, 1);      // obj key val
+                userData->m_bHasStorage = true;
             }
 
-            lua_pushvalue(_luaState, 2); // obj key val gT storage {} key
-            lua_pushvalue(_luaState, 3); // obj key val gT storage {} key value
-            lua_settable(_luaState, -3); // obj key val gT storage {key = value}
+            pushUserValue(_luaState, 1); // obj key val storage
+            lua_pushvalue(_luaState, 2); // obj key val storage key
+            lua_pushvalue(_luaState, 3); // obj key val storage key value
+            lua_rawset(_luaState, -3);   // obj key val storage
 
             return 0;
         }
@@ -3586,48 +6063,55 @@ namespace luanatic
         template <class T>
         inline stick::Int32 index(lua_State * _luaState)
         {
-            T * obj = convertToType<T>(_luaState, 1);
-
-            lua_getfield(_luaState, LUA_REGISTRYINDEX, LUANATIC_KEY); // obj key gT
-            lua_getfield(_luaState, -1, "storage"); // obj key gT storage
-
-            ObjectIdentifier<T>::identify(_luaState,  obj); // obj key gT storage id
-            lua_gettable(_luaState, -2);        // obj key gT storage objectStorage
-
-            // check if storage table exists for this object
-            if (!lua_isnil(_luaState, -1))
+            // scripts can call the metamethod with anything, so the UserData is only read if self
+            // is an instance of this class table (upvalue 2). Anything else has to convert to T.
+            bool bInstance = lua_type(_luaState, 1) == LUA_TUSERDATA && lua_getmetatable(_luaState, 1);
+            if (bInstance)
             {
-                lua_pushvalue(_luaState, -4); // obj key gT storage objectStorage key
-                lua_gettable(_luaState, -2); // obj key gT storage objectStorage objectStorage[key]
+                bInstance = lua_rawequal(_luaState, -1, lua_upvalueindex(2)) == 1;
+                lua_pop(_luaState, 1);
             }
+            if (!bInstance)
+                convertToTypeAndCheck<T>(_luaState, 1);
 
-            // If either there is no storage table or the key wasn't found
-            // then fall back to the metatable
-            if (lua_isnil(_luaState, -1))
+            // only instances that got dynamic fields have a storage table
+            if (static_cast<UserData *>(lua_touserdata(_luaState, 1))->m_bHasStorage)
             {
-                lua_settop(_luaState, 2);        // obj key
-                lua_getmetatable(_luaState, -2); // obj key mt
-                lua_pushvalue(_luaState, -2);    // obj key mt k
-                lua_gettable(_luaState, -2);     // obj key mt mt[k]
+                pushUserValue(_luaState, 1); // obj key storage
+                lua_pushvalue(_luaState, 2); // obj key storage key
+                lua_rawget(_luaState, -2);   // obj key storage storage[key]
+                if (!lua_isnil(_luaState, -1))
+                    return 1;
+                lua_settop(_luaState, 2);    // obj key
+            }
 
-                // look in the attributes table
-                if (lua_isnil(_luaState, -1))
-                {
-                    lua_pop(_luaState, 1); // obj key mt
-                    lua_getfield(_luaState, -1, "__attributes"); // obj key mt __attributes
-                    lua_pushvalue(_luaState, -3); // obj key mt __attributes key
-                    lua_gettable(_luaState, -2); // obj key mt __attributes funcOrNil
+            // entries of the class table (upvalue 2) take precedence over attributes, this also picks up
+            // members that were added or replaced from lua after the class was registered
+            lua_pushvalue(_luaState, 2);                // obj key key
+            lua_rawget(_luaState, lua_upvalueindex(2)); // obj key memberOrNil
+            if (!lua_isnil(_luaState, -1))
+                return 1;
+            lua_pop(_luaState, 1);                      // obj key
 
-                    // if we found a function, we call it
-                    if (!lua_isnil(_luaState, -1))
-                    {
-                        // call as getter
-                        lua_pushvalue(_luaState, 1); // self
-                        lua_call(_luaState, 1, 1);
-                    }
-                }
+            // attributes are called in place through the accessor table of the class (upvalue 1)
+            lua_pushvalue(_luaState, 2);                // obj key key
+            lua_rawget(_luaState, lua_upvalueindex(1)); // obj key accessorOrNil
+            if (AttributeAccessor * accessor = toAttributeAccessor(_luaState, -1))
+            {
+                lua_settop(_luaState, 1); // obj
+                return accessor->function(_luaState);
             }
 
+            // fall back to attributes that were added from lua
+            lua_settop(_luaState, 2);                          // obj key
+            lua_getfield(_luaState, lua_upvalueindex(2), "__attributes"); // obj key __attributes
+            lua_pushvalue(_luaState, 2);                       // obj key __attributes key
+            lua_rawget(_luaState, -2);                         // obj key __attributes funcOrNil
+
+            // if we found a function, we call it as getter
+            if (!lua_isnil(_luaState, -1))
+                return callAttribute(_luaState, 1);
+
             return 1;
         }
 
@@ -3653,15 +6137,23 @@ namespace luanatic
                 LuanaticState * state = luanaticState(_luaState);
                 STICK_ASSERT(state != nullptr);
 
-                removeStorage<T>(_luaState, obj);
-
                 //for the ownership, we take the userdata addr as the identifier, because the pointer might have been
                 //reused by the application, before lua collected it, which can cause conflicts. the userdata addr
                 //on the other hand will be unique for the same object.
                 UserData * addr = (UserData *)lua_touserdata(_luaState, 1);
                 if (addr->m_bOwnedByLua)
                 {
-                    state->m_allocator->destroy(obj);
+                    //inline objects live in the userdata block that lua is about to free
+                    if (addr->m_storageMode == StorageMode::Inline)
+                        obj->~T();
+                    else if (addr->m_storageMode == StorageMode::Pooled)
+                    {
+                        //pooled objects are always of the exact class type, so m_data is the slot
+                        obj->~T();
+                        classAt(*state, addr->m_classIndex).pool->deallocate(addr->m_data);
+                    }
+                    else
+                        state->m_allocator->destroy(obj);
                 }
             }
 
@@ -3852,12 +6344,68 @@ namespace luanatic
     inline lua_State * createLuaState()
     {
 #if LUA_VERSION_NUM >= 502
-        return luaL_newstate();
+        //same as luaL_newstate, but with an allocation function that luanatic can recognize
+        lua_State * ret = lua_newstate(detail::defaultLuaAlloc, nullptr);
+        if (!ret)
+            return nullptr;
+#ifdef LUANATIC_USE_EXTRASPACE
+        //threads copy the extra space of the main thread, make sure it's zeroed
+        detail::extraSpaceLuanaticState(ret) = nullptr;
+#endif //LUANATIC_USE_EXTRASPACE
+        lua_atpanic(ret, detail::luaPanic);
+        return ret;
 #else
         return lua_open();
 #endif
     }
 
+    inline lua_State * createLuaState(lua_Alloc _allocFunction, void * _userData)
+    {
+        detail::ForwardingLuaAlloc * alloc = static_cast<detail::ForwardingLuaAlloc *>(
+            _allocFunction(_userData, nullptr, 0, sizeof(detail::ForwardingLuaAlloc)));
+        if (!alloc)
+            return nullptr;
+        *alloc = {_allocFunction, _userData, nullptr, false};
+        lua_State * ret = lua_newstate(detail::ForwardingLuaAlloc::allocFunction, alloc);
+        if (!ret)
+        {
+            _allocFunction(_userData, alloc, sizeof(detail::ForwardingLuaAlloc), 0);
+            return nullptr;
+        }
+        alloc->m_bOwnedByState = true;
+#ifdef LUANATIC_USE_EXTRASPACE
+        detail::extraSpaceLuanaticState(ret) = nullptr;
+#endif //LUANATIC_USE_EXTRASPACE
+        lua_atpanic(ret, detail::luaPanic);
+        return ret;
+    }
+
+    inline lua_State * createLuaState(stick::Allocator & _allocator)
+    {
+        detail::LuaAllocator * alloc = _allocator.create<detail::LuaAllocator>(_allocator);
+        lua_State * ret = lua_newstate(detail::LuaAllocator::allocFunction, alloc);
+        if (!ret)
+        {
+            _allocator.destroy(alloc);
+            return nullptr;
+        }
+        alloc->m_bOwnedByState = true;
+#ifdef LUANATIC_USE_EXTRASPACE
+        detail::extraSpaceLuanaticState(ret) = nullptr;
+#endif //LUANATIC_USE_EXTRASPACE
+        //same as luaL_newstate
+        lua_atpanic(ret, detail::luaPanic);
+        return ret;
+    }
+
+    inline stick::Maybe<LuaAllocatorStatistics> luaAllocatorStatistics(lua_State * _state)
+    {
+        void * userData;
+        if (lua_getallocf(_state, &userData) != detail::LuaAllocator::allocFunction)
+            return stick::Maybe<LuaAllocatorStatistics>();
+        return static_cast<detail::LuaAllocator *>(userData)->m_stats;
+    }
+
     inline void initialize(lua_State * _state, stick::Allocator & _allocator)
     {
         //create the glua tables in the registry
@@ -3870,16 +6418,12 @@ namespace luanatic
             stick::Int32 luanaticTable = lua_gettop(_state);
 
             constructUnregisteredType<detail::LuanaticState>(_state, std::ref(_allocator));
+
             lua_setfield(_state, -2, "LuanaticState");
 
             lua_pushvalue(_state, luanaticTable);
             lua_setfield(_state, LUA_REGISTRYINDEX, LUANATIC_KEY);
 
-            //create a storage table that c++ objects can store fields in that were created on the lua side
-            //(so it feels similar to a normal lua object / table)
-            lua_newtable(_state);
-            lua_setfield(_state, luanaticTable, "storage");
-
             //weak table holding all the userdata that goes through this GluaState
             lua_newtable(_state);
             lua_newtable(_state);
@@ -3888,6 +6432,8 @@ namespace luanatic
             lua_setmetatable(_state, -2);
             lua_setfield(_state, luanaticTable, "weakTable");
 
+            detail::registerBufferMetatable(_state, *detail::luanaticState(_state));
+
             //utility functions to check bases and create glua style classes on the lua side
             LuaValue gt = globalsTable(_state);
             LuaValue lntcNamespace = gt.findOrCreateTable("luanatic");
@@ -3897,9 +6443,22 @@ namespace luanatic
             
             //lntcNamespace.registerFunction("ensureClass", detail::gluaEnsureClass);
             lntcNamespace.reset(); //reset to pop off the key from the stack
+
+            //bulk math over buffers
+            detail::registerSimdLibrary(_state);
             lua_pop(_state, 1);
         }
         lua_pop(_state, 1);
+
+#ifdef LUANATIC_USE_EXTRASPACE
+        //cache the state in the main thread (so that new threads inherit it) and the current one.
+        //This is only read back for states created with createLuaState, see hasLuanaticExtraSpace.
+        detail::LuanaticState * ls = detail::luanaticStateFromRegistry(_state);
+        lua_rawgeti(_state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+        detail::extraSpaceLuanaticState(lua_tothread(_state, -1)) = ls;
+        lua_pop(_state, 1);
+        detail::extraSpaceLuanaticState(_state) = ls;
+#endif //LUANATIC_USE_EXTRASPACE
     }
 
     inline void openStandardLibraries(lua_State * _state)
@@ -61,6 +61,97 @@ struct TestClass
 Int32 TestClass::s_destructionCounter = 0;
 Int32 TestClass::s_staticFuncCounter = 0;
 
+//over aligned to check the object placement inside of inline userdata
+struct alignas(16) InlineClass
+{
+    InlineClass(Int32 _val) :
+        val(_val)
+    {
+
+    }
+
+    InlineClass(const InlineClass & _other) :
+        val(_other.val)
+    {
+        s_copyCounter++;
+    }
+
+    InlineClass(InlineClass && _other) :
+        val(_other.val)
+    {
+
+    }
+
+    ~InlineClass()
+    {
+        s_destructionCounter++;
+    }
+
+    Int32 get() const
+    {
+        return val;
+    }
+
+    static Int32 s_destructionCounter;
+    static Int32 s_copyCounter;
+
+    Int32 val;
+};
+
+Int32 InlineClass::s_destructionCounter = 0;
+Int32 InlineClass::s_copyCounter = 0;
+
+InlineClass makeInlineClass(Int32 _val)
+{
+    return InlineClass(_val);
+}
+
+//over aligned to check the slot alignment of pooled storage
+struct alignas(32) PooledClass
+{
+    PooledClass(Int32 _val) :
+        val(_val)
+    {
+
+    }
+
+    ~PooledClass()
+    {
+        s_destructionCounter++;
+    }
+
+    static Int32 s_destructionCounter;
+
+    Int32 val;
+};
+
+Int32 PooledClass::s_destructionCounter = 0;
+
+PooledClass makePooledClass(Int32 _val)
+{
+    return PooledClass(_val);
+}
+
+struct PlainClass
+{
+    PlainClass() :
+        val(1)
+    {
+
+    }
+
+    Int32 get() const
+    {
+        return val;
+    }
+
+    Int32 val;
+};
+
+struct PlainDerived : public PlainClass
+{
+};
+
 struct A
 {
     A() :
@@ -216,6 +307,60 @@ static DynamicArray<Int32> numbersCopy()
     return {2, 4, 6, 8, 10, 12};
 }
 
+static DynamicArray<Float32> & samples()
+{
+    static DynamicArray<Float32> s_samples = {0.5f, 1.5f, 2.5f};
+    return s_samples;
+}
+
+static const DynamicArray<Int32> * indices()
+{
+    static DynamicArray<Int32> s_indices = {3, 2, 1};
+    return &s_indices;
+}
+
+static Int32 sumNumbers(DynamicArray<Int32> _numbers)
+{
+    Int32 ret = 0;
+    for (Int32 n : _numbers)
+        ret += n;
+    return ret;
+}
+
+static Float32 sumEvery(luanatic::TableView<Float32> _view, UInt32 _step)
+{
+    Float32 ret = 0;
+    for (Size i = 0; i < _view.count(); i += _step)
+        ret += _view[i];
+    return ret;
+}
+
+static String joinStrings(const luanatic::TableView<String> & _view)
+{
+    String ret;
+    for (String str : _view)
+        ret.append(str);
+    return ret;
+}
+
+static bool isPlayerTag(const luanatic::StringView & _tag)
+{
+    return _tag == "player";
+}
+
+static luanatic::StringView firstWord(luanatic::StringView _str)
+{
+    Size i = 0;
+    while (i < _str.length() && _str.data()[i] != ' ')
+        ++i;
+    return luanatic::StringView(_str.data(), i);
+}
+
+static String echoString(const String & _str)
+{
+    return _str;
+}
+
 static void printCString(const char * _str)
 {
     printf("A C STRING: %s\n", _str);
@@ -266,7 +411,7 @@ namespace luanatic
         {
             static UserData cast(const UserData & _ud, detail::LuanaticState & _state)
             {
-                return {(To *) & static_cast<Wrapper<From> *>(_ud.m_data)->wrpd, _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID()};
+                return {(To *) & static_cast<Wrapper<From> *>(_ud.m_data)->wrpd, _ud.m_bOwnedByLua, stick::TypeInfoT<To>::typeID(), 0, StorageMode::Allocator, false};
             }
         };
     }
@@ -471,6 +616,90 @@ void func(T && _element)
     Bar<T>::print(std::forward<T>(_element));
 }
 
+//forwards to the default allocator and keeps track of the blocks that are alive.
+//New allocations fail while bFailAllocations is set.
+class CountingAllocator : public Allocator
+{
+public:
+
+    CountingAllocator() :
+        blockCount(0),
+        bFailAllocations(false)
+    {
+
+    }
+
+    Block allocate(Size _byteCount, Size _alignment) override
+    {
+        if (bFailAllocations)
+            return {nullptr, 0};
+        Block ret = defaultAllocator().allocate(_byteCount, _alignment);
+        if (ret.ptr)
+            blockCount++;
+        return ret;
+    }
+
+    Block reallocate(const Block & _blk, Size _byteCount, Size _alignment) override
+    {
+        return defaultAllocator().reallocate(_blk, _byteCount, _alignment);
+    }
+
+    void deallocate(const Block & _block) override
+    {
+        blockCount--;
+        defaultAllocator().deallocate(_block);
+    }
+
+    Size blockCount;
+    bool bFailAllocations;
+};
+
+//lua_Alloc that fills new blocks with garbage, like recycled heap memory, and counts the live blocks
+static void * garbageLuaAlloc(void * _userData, void * _ptr, size_t _oldSize, size_t _newSize)
+{
+    Size & blockCount = *static_cast<Size *>(_userData);
+    if (_newSize == 0)
+    {
+        if (_ptr)
+            blockCount--;
+        std::free(_ptr);
+        return nullptr;
+    }
+    void * ret = std::realloc(_ptr, _newSize);
+    if (ret && !_ptr)
+    {
+        std::memset(ret, 0xAB, _newSize);
+        blockCount++;
+    }
+    return ret;
+}
+
+//fails every allocation after the first _failAfter ones
+struct FailingLuaAlloc
+{
+    Size failAfter;
+    Size allocationCount;
+    Size blockCount;
+};
+
+static void * failingLuaAlloc(void * _userData, void * _ptr, size_t _oldSize, size_t _newSize)
+{
+    FailingLuaAlloc & fa = *static_cast<FailingLuaAlloc *>(_userData);
+    if (_newSize == 0)
+    {
+        if (_ptr)
+            fa.blockCount--;
+        std::free(_ptr);
+        return nullptr;
+    }
+    if (fa.allocationCount++ >= fa.failAfter)
+        return nullptr;
+    void * ret = std::realloc(_ptr, _newSize);
+    if (ret && !_ptr)
+        fa.blockCount++;
+    return ret;
+}
+
 //for overload testing
 Int32 overloadedFunction(Int32 _a, UInt32 _b)
 {
@@ -487,6 +716,93 @@ const char * overloadedFunction(const char * _str)
     return _str;
 }
 
+const char * signOverload(UInt32 _a)
+{
+    return "unsigned";
+}
+
+const char * signOverload(const String & _a)
+{
+    return "string";
+}
+
+//value types converted from one of a list of names, the overload is picked by the string contents
+template<Int32 Kind>
+struct NamedValue
+{
+    Int32 index;
+};
+
+using ColorName = NamedValue<0>;
+using ShapeName = NamedValue<1>;
+
+static Int32 findName(Int32 _kind, lua_State * _state, Int32 _index)
+{
+    static const char * names[2][2] = {{"red", "green"}, {"circle", "square"}};
+    if (lua_type(_state, _index) != LUA_TSTRING)
+        return -1;
+    const char * str = lua_tostring(_state, _index);
+    for (Int32 i = 0; i < 2; ++i)
+    {
+        if (std::strcmp(str, names[_kind][i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const char * namedOverload(ColorName _a)
+{
+    return "color";
+}
+
+const char * namedOverload(ShapeName _a)
+{
+    return "shape";
+}
+
+namespace luanatic
+{
+    template <Int32 Kind>
+    struct ValueTypeConverter<NamedValue<Kind>>
+    {
+        static NamedValue<Kind> convertAndCheck(lua_State * _state, stick::Int32 _index)
+        {
+            Int32 index = findName(Kind, _state, _index);
+            if (index == -1)
+                luaL_argerror(_state, _index, "Unknown name");
+            return {index};
+        }
+
+        static stick::Int32 push(lua_State * _state, const NamedValue<Kind> & _value)
+        {
+            lua_pushinteger(_state, _value.index);
+            return 1;
+        }
+    };
+
+    namespace detail
+    {
+        template <Int32 Kind>
+        struct LuaTypeScore<NamedValue<Kind>>
+        {
+            static stick::Int32 score(lua_State * _state, stick::Int32 _index)
+            {
+                return findName(Kind, _state, _index) != -1 ? 0 : std::numeric_limits<stick::Int32>::max();
+            }
+        };
+    }
+}
+
+Int32 ambiguousOverload(Int32 _a)
+{
+    return _a;
+}
+
+Float32 ambiguousOverload(Float32 _a)
+{
+    return _a;
+}
+
 const Suite spec[] =
 {
     SUITE("Basic Tests")
@@ -554,6 +870,12 @@ const Suite spec[] =
             luanatic::LuaValue iioFunc = luanaticNamespace["isInstanceOf"];
             EXPECT(iioFunc.type() == luanatic::LuaType::Function);
 
+            //threads need to resolve to the same luanatic state as their main thread
+            luanatic::detail::LuanaticState * ls = luanatic::detail::luanaticState(state);
+            EXPECT(ls != nullptr);
+            lua_State * thread = lua_newthread(state);
+            EXPECT(luanatic::detail::luanaticState(thread) == ls);
+            lua_pop(state, 1);
         }
         EXPECT(lua_gettop(state) == 0);
         printf("ARGH %i\n", lua_gettop(state));
@@ -605,6 +927,7 @@ const Suite spec[] =
             luanatic::ClassWrapper<TestClass> tw("TestClass");
             tw.
             addConstructor<Int32>("new").
+            addConstructor<Int32>().
             addMemberFunction("add", LUANATIC_FUNCTION(&TestClass::add)).
             addMemberFunction("addViaPointer", LUANATIC_FUNCTION(&TestClass::addViaPointer)).
             addMemberFunction("get", LUANATIC_FUNCTION(&TestClass::get)).
@@ -627,21 +950,250 @@ const Suite spec[] =
                              "anotherVar.other = someVariable\n"
                              "anotherVar.other:add(someVariable)\n"
                              "assert(anotherVar.other.val == 6)\n"
-                             "TestClass.staticFunction()";
+                             "TestClass.staticFunction()\n"
+                             "niceVar = TestClass(2) assert(niceVar:get() == 2)\n"
+                             "assert(not pcall(TestClass, 'a'))";
 
             auto err = luanatic::execute(state, luaCode);
             if (err)
                 printf("%s\n", err.message().cString());
             EXPECT(!err);
 
+            //pushing a lua owned object again needs to yield the same userdata
+            lua_getglobal(state, "niceVar");
+            TestClass * nice = luanatic::convertToType<TestClass>(state, -1);
+            EXPECT(nice && nice->val == 2);
+            luanatic::push<TestClass>(state, nice, true);
+            EXPECT(lua_rawequal(state, -1, -2));
+            lua_pop(state, 2);
+
             // auto sref = TestClass
         }
         EXPECT(lua_gettop(state) == 0);
         lua_close(state);
         printf("DC BABY: %i\n", TestClass::s_destructionCounter);
-        EXPECT(TestClass::s_destructionCounter == 2);
+        EXPECT(TestClass::s_destructionCounter == 3);
         EXPECT(TestClass::s_staticFuncCounter == 1);
     },
+    SUITE("Inline Storage Tests")
+    {
+        lua_State * state = luanatic::createLuaState();
+        {
+            luanatic::openStandardLibraries(state);
+            luanatic::initialize(state);
+            luanatic::LuaValue globals = luanatic::globalsTable(state);
+
+            luanatic::ClassWrapper<InlineClass> iw("InlineClass");
+            iw.
+            setStorageMode(luanatic::StorageMode::Inline).
+            addConstructor<Int32>().
+            addMemberFunction("get", LUANATIC_FUNCTION(&InlineClass::get)).
+            addAttribute("val", LUANATIC_ATTRIBUTE(&InlineClass::val));
+            globals.registerClass(iw);
+            globals.registerFunction("makeInlineClass", LUANATIC_FUNCTION(&makeInlineClass));
+
+            String luaCode = "local a = InlineClass(3) assert(a:get() == 3)\n"
+                             "a.val = 5 assert(a.val == 5)\n"
+                             "local b = makeInlineClass(7) assert(b:get() == 7)\n"
+                             "for i = 1, 10 do InlineClass(i) end\n"
+                             "inlineObj = InlineClass(11)";
+            auto err = luanatic::execute(state, luaCode);
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            lua_getglobal(state, "inlineObj");
+            luanatic::detail::UserData * ud = static_cast<luanatic::detail::UserData *>(lua_touserdata(state, -1));
+            InlineClass * obj = luanatic::convertToType<InlineClass>(state, -1);
+            EXPECT(ud->m_storageMode == luanatic::StorageMode::Inline);
+            EXPECT(obj == luanatic::detail::InlineStorage<InlineClass>::objectAddress(ud));
+            EXPECT(reinterpret_cast<std::uintptr_t>(obj) % alignof(InlineClass) == 0);
+            EXPECT(obj->val == 11);
+            lua_pop(state, 1);
+        }
+        EXPECT(lua_gettop(state) == 0);
+        lua_close(state);
+        //13 lua owned objects, 1 temporary returned from makeInlineClass
+        EXPECT(InlineClass::s_destructionCounter == 14);
+        //by value results are moved into lua
+        EXPECT(InlineClass::s_copyCounter == 0);
+    },
+    SUITE("Pooled Storage Tests")
+    {
+        lua_State * state = luanatic::createLuaState();
+        {
+            luanatic::openStandardLibraries(state);
+            luanatic::initialize(state);
+            luanatic::LuaValue globals = luanatic::globalsTable(state);
+
+            luanatic::ClassWrapper<PooledClass> pw("PooledClass");
+            pw.
+            setStorageMode(luanatic::StorageMode::Pooled).
+            setPoolSlabSize(4).
+            addConstructor<Int32>().
+            addAttribute("val", LUANATIC_ATTRIBUTE(&PooledClass::val));
+            globals.registerClass(pw);
+            globals.registerFunction("makePooledClass", LUANATIC_FUNCTION(&makePooledClass));
+
+            //more objects than fit into one slab
+            String luaCode = "local objs = {}\n"
+                             "for i = 1, 10 do objs[i] = PooledClass(i) end\n"
+                             "for i = 1, 10 do assert(objs[i].val == i) end\n"
+                             "objs[11] = makePooledClass(11) assert(objs[11].val == 11)\n"
+                             "pooledObj = PooledClass(12) objs = nil collectgarbage()";
+            auto err = luanatic::execute(state, luaCode);
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            lua_getglobal(state, "pooledObj");
+            luanatic::detail::UserData * ud = static_cast<luanatic::detail::UserData *>(lua_touserdata(state, -1));
+            PooledClass * obj = luanatic::convertToType<PooledClass>(state, -1);
+            EXPECT(ud->m_storageMode == luanatic::StorageMode::Pooled);
+            EXPECT(reinterpret_cast<std::uintptr_t>(obj) % alignof(PooledClass) == 0);
+            EXPECT(obj->val == 12);
+            lua_pop(state, 1);
+
+            //collected objects give their slot back for the next one
+            err = luanatic::execute(state, "pooledObj = nil collectgarbage() pooledObj = PooledClass(13)");
+            EXPECT(!err);
+            lua_getglobal(state, "pooledObj");
+            EXPECT(luanatic::convertToType<PooledClass>(state, -1) == obj);
+            lua_pop(state, 1);
+
+            //objects of a previous registration still return their slots
+            globals.registerClass(pw);
+            err = luanatic::execute(state, "pooledObj = nil collectgarbage() pooledObj = PooledClass(14) assert(pooledObj.val == 14)");
+            EXPECT(!err);
+        }
+        EXPECT(lua_gettop(state) == 0);
+        lua_close(state);
+        //14 lua owned objects, 1 temporary returned from makePooledClass
+        EXPECT(PooledClass::s_destructionCounter == 15);
+    },
+    SUITE("Index Tests")
+    {
+        lua_State * state = luanatic::createLuaState();
+        {
+            luanatic::openStandardLibraries(state);
+            luanatic::initialize(state);
+            luanatic::LuaValue globals = luanatic::globalsTable(state);
+
+            luanatic::ClassWrapper<PlainClass> pw("PlainClass");
+            pw.
+            addConstructor<>().
+            addMemberFunction("get", LUANATIC_FUNCTION(&PlainClass::get));
+            globals.registerClass(pw);
+
+            luanatic::ClassWrapper<PlainDerived> dw("PlainDerived");
+            dw.
+            setCacheBorrowed(true).
+            addBase<PlainClass>().
+            addConstructor<>().
+            addAttribute("val", LUANATIC_ATTRIBUTE(&PlainDerived::val));
+            globals.registerClass(dw);
+
+            //classes without attributes resolve members through the class table until an instance gets dynamic fields
+            String luaCode = "local a = PlainClass() local b = PlainClass()\n"
+                             "assert(getmetatable(a).__index == PlainClass) assert(a:get() == 1)\n"
+                             "a.dynamic = 5 assert(a.dynamic == 5) assert(a:get() == 1)\n"
+                             "assert(type(getmetatable(a).__index) == 'function')\n"
+                             "assert(b.dynamic == nil) assert(b:get() == 1)\n"
+                             "local d = PlainDerived()\n"
+                             "assert(type(getmetatable(d).__index) == 'function')\n"
+                             "d.val = 3 assert(d:get() == 3) assert(d.val == 3)\n"
+                             "getmetatable(d).__attributes.twice = function(self, v) if v then self.val = math.floor(v / 2) else return self.val * 2 end end\n"
+                             "d.twice = 8 assert(d.val == 4) assert(d.twice == 8)\n"
+                             //C closures added from lua need their own call frame
+                             "getmetatable(d).__attributes.wrapped = coroutine.wrap(function() while true do coroutine.yield(42) end end)\n"
+                             "assert(d.wrapped == 42) getmetatable(d).__attributes.wrapped = nil\n"
+                             "local accessors = getmetatable(d).__accessors\n"
+                             "assert(accessors.get == nil) assert(type(accessors.val) == 'userdata')\n"
+                             "function PlainDerived:late() return 42 end assert(d:late() == 42)\n"
+                             //members replaced from lua after registration win, with and without attributes
+                             "local derivedGet, plainGet = PlainDerived.get, PlainClass.get\n"
+                             "PlainDerived.get = function(self) return 99 end assert(d:get() == 99)\n"
+                             "PlainClass.get = function(self) return 7 end assert(b:get() == 7) assert(a:get() == 7)\n"
+                             "PlainDerived.get, PlainClass.get = derivedGet, plainGet assert(d:get() == 4) assert(b:get() == 1)\n"
+                             //calling the metamethods with something that is not an instance raises an error
+                             "assert(not pcall(getmetatable(d).__index, {}, 'val'))\n"
+                             "assert(not pcall(getmetatable(a).__index, 'str', 'dynamic'))\n"
+                             "assert(not pcall(getmetatable(d).__newindex, {}, 'val', 1))\n"
+                             "plainA = a plainB = b";
+            auto err = luanatic::execute(state, luaCode);
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            //only the instance with dynamic fields is flagged to have storage
+            lua_getglobal(state, "plainA");
+            lua_getglobal(state, "plainB");
+            EXPECT(static_cast<luanatic::detail::UserData *>(lua_touserdata(state, -2))->m_bHasStorage);
+            EXPECT(!static_cast<luanatic::detail::UserData *>(lua_touserdata(state, -1))->m_bHasStorage);
+
+            //dynamic fields live in the uservalue of the instance
+            luanatic::detail::pushUserValue(state, -2);
+            EXPECT(lua_istable(state, -1));
+            lua_getfield(state, -1, "dynamic");
+            EXPECT(lua_tointeger(state, -1) == 5);
+            lua_pop(state, 4);
+
+            //borrowed objects get their own fields that go away with the userdata
+            PlainClass borrowed;
+            luanatic::push<PlainClass>(state, &borrowed, false);
+            lua_setglobal(state, "borrowed");
+            err = luanatic::execute(state, "borrowed.tmp = {} assert(borrowed.tmp ~= nil) borrowed = nil collectgarbage()");
+            EXPECT(!err);
+            luanatic::push<PlainClass>(state, &borrowed, false);
+            lua_setglobal(state, "borrowed");
+            err = luanatic::execute(state, "assert(borrowed.tmp == nil) borrowed = nil");
+            EXPECT(!err);
+
+            //only classes that opted in reuse the userdata for repeated borrowed pushes
+            luanatic::push<PlainClass>(state, &borrowed, false);
+            luanatic::push<PlainClass>(state, &borrowed, false);
+            EXPECT(!lua_rawequal(state, -1, -2));
+            lua_pop(state, 2);
+            PlainDerived cached;
+            luanatic::push<PlainDerived>(state, &cached, false);
+            luanatic::push<PlainDerived>(state, &cached, false);
+            EXPECT(lua_rawequal(state, -1, -2));
+            lua_pop(state, 2);
+            EXPECT(lua_gettop(state) == 0);
+
+            //pushing doesn't depend on the class name in the namespace table
+            err = luanatic::execute(state, "PlainClass = 'shadowed'");
+            EXPECT(!err);
+            luanatic::push<PlainClass>(state, &borrowed, false);
+            lua_setglobal(state, "shadowTest");
+            err = luanatic::execute(state, "assert(shadowTest:get() == 1)");
+            EXPECT(!err);
+
+            //the cached class index of a type must not leak into a state that registered it at a different index
+            lua_State * other = luanatic::createLuaState();
+            {
+                luanatic::initialize(other);
+                luanatic::LuaValue otherGlobals = luanatic::globalsTable(other);
+                luanatic::ClassWrapper<InlineClass> iw("InlineClass");
+                otherGlobals.registerClass(iw);
+                otherGlobals.registerClass(pw);
+                for (Size i = 0; i < 2; ++i)
+                {
+                    luanatic::push<PlainClass>(state, &borrowed, false);
+                    luanatic::push<PlainClass>(other, &borrowed, false);
+                    lua_getmetatable(state, -1);
+                    EXPECT(lua_topointer(state, -1) == luanatic::detail::classAt(*luanatic::detail::luanaticState(state), 1).metatable);
+                    lua_getmetatable(other, -1);
+                    EXPECT(lua_topointer(other, -1) == luanatic::detail::classAt(*luanatic::detail::luanaticState(other), 2).metatable);
+                    lua_pop(state, 2);
+                    lua_pop(other, 2);
+                }
+            }
+            lua_close(other);
+        }
+        EXPECT(lua_gettop(state) == 0);
+        lua_close(state);
+    },
     SUITE("Inheritance Tests")
     {
         lua_State * state = luanatic::createLuaState();
@@ -705,6 +1257,29 @@ const Suite spec[] =
             if (err)
                 printf("%s\n", err.message().cString());
             EXPECT(!err);
+
+            //the dense class index is stored in the userdata and the class table
+            D d(1, 2, 3);
+            luanatic::push<D>(state, &d, false);
+            luanatic::detail::UserData * ud = static_cast<luanatic::detail::UserData *>(lua_touserdata(state, -1));
+            lua_getmetatable(state, -1);
+            lua_getfield(state, -1, "__classIndex");
+            EXPECT(ud->m_classIndex > 0);
+            EXPECT(lua_tointeger(state, -1) == ud->m_classIndex);
+            luanatic::detail::LuanaticState * ls = luanatic::detail::luanaticState(state);
+            EXPECT(luanatic::detail::hasAncestor(*ls, ud->m_classIndex, luanatic::detail::findClassIndex(*ls, stick::TypeInfoT<A>::typeID())));
+            EXPECT(luanatic::detail::hasAncestor(*ls, ud->m_classIndex, luanatic::detail::findClassIndex(*ls, stick::TypeInfoT<B>::typeID())));
+            EXPECT(!luanatic::detail::hasAncestor(*ls, ud->m_classIndex, luanatic::detail::findClassIndex(*ls, stick::TypeInfoT<CoolClass>::typeID())));
+            EXPECT(luanatic::convertToType<A>(state, -3) == static_cast<A *>(&d));
+            EXPECT(luanatic::convertToType<B>(state, -3) == static_cast<B *>(&d));
+            lua_pop(state, 3);
+
+            //userdata that was not pushed as a registered class must never be identified as one
+            luanatic::pushUnregisteredType(state, 5.0);
+            EXPECT(!luanatic::isOfType<A>(state, -1, false));
+            EXPECT(luanatic::convertToType<A>(state, -1) == nullptr);
+            EXPECT(luanatic::conversionScore<A>(state, -1) == std::numeric_limits<Int32>::max());
+            lua_pop(state, 1);
         }
         {
             using namespace luanatic;
@@ -769,6 +1344,41 @@ const Suite spec[] =
             CustomValueType cvt2 = globals["myVar2"].get<CustomValueType>();
             EXPECT(cvt2.a == 66);
             EXPECT(cvt2.b == 23);
+
+            //arrays are converted from the sequence part of the table in order, also from relative indices
+            err = luanatic::execute(state, "floatArray = {1.5, 2.5, 3.5, foo = 'bar'} stringArray = {'a', 'b', 'c', x = 1}");
+            EXPECT(!err);
+            lua_getglobal(state, "floatArray");
+            lua_getglobal(state, "stringArray");
+            auto strings = luanatic::convertToValueTypeAndCheck<DynamicArray<String>>(state, -1);
+            auto floats = luanatic::convertToValueTypeAndCheck<DynamicArray<Float32>>(state, -2);
+            EXPECT(strings.count() == 3);
+            EXPECT(strings[0] == "a" && strings[1] == "b" && strings[2] == "c");
+            EXPECT(floats.count() == 3);
+            EXPECT(floats[0] == 1.5f && floats[1] == 2.5f && floats[2] == 3.5f);
+            lua_pop(state, 2);
+
+            globals.registerFunction("sumNumbers", LUANATIC_FUNCTION(&sumNumbers));
+            globals.registerFunction("sumEvery", LUANATIC_FUNCTION(&sumEvery));
+            globals.registerFunction("joinStrings", LUANATIC_FUNCTION(&joinStrings));
+            globals.registerFunction("isPlayerTag", LUANATIC_FUNCTION(&isPlayerTag));
+            globals.registerFunction("firstWord", LUANATIC_FUNCTION(&firstWord));
+            globals.registerFunction("echoString", LUANATIC_FUNCTION(&echoString));
+            err = luanatic::execute(state, "assert(sumNumbers({1, 2, 3}) == 6) assert(sumNumbers({}) == 0)\n"
+                                    "assert(not pcall(sumNumbers, {1, 'x'})) assert(not pcall(sumNumbers, {1, 2.5}))\n"
+                                    "assert(sumEvery({1, 2, 3, 4, 5, x = 1}, 2) == 9) assert(sumEvery({}, 1) == 0)\n"
+                                    //elements are checked before the call, even the ones that are never accessed
+                                    "assert(not pcall(sumEvery, {1, 'x', 3}, 2)) assert(not pcall(sumEvery, {1, 'x'}, 1))\n"
+                                    "assert(not pcall(sumEvery, 1, 1))\n"
+                                    "assert(joinStrings({'a', 'b', 'c'}) == 'abc') assert(joinStrings({'a', 1}) == 'a1')\n"
+                                    "assert(not pcall(joinStrings, {'a', {}}))\n"
+                                    "assert(isPlayerTag('player') and not isPlayerTag('play') and not isPlayerTag('player\\0'))\n"
+                                    "assert(firstWord('hello world') == 'hello') assert(firstWord('') == '')\n"
+                                    "assert(not pcall(isPlayerTag, {}))\n"
+                                    "assert(echoString('a\\0b') == 'a\\0b')");
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
         }
         EXPECT(lua_gettop(state) == 0);
         lua_close(state);
@@ -799,6 +1409,209 @@ const Suite spec[] =
         EXPECT(lua_gettop(state) == 0);
         lua_close(state);
     },
+    SUITE("Buffer Tests")
+    {
+        lua_State * state = luanatic::createLuaState();
+        {
+            luanatic::openStandardLibraries(state);
+            luanatic::initialize(state);
+            luanatic::LuaValue globals = luanatic::globalsTable(state);
+
+            globals.registerFunction("samples", LUANATIC_FUNCTION(&samples, luanatic::ReturnBuffer<luanatic::ph::Result>));
+            globals.registerFunction("indices", LUANATIC_FUNCTION(&indices, luanatic::ReturnBuffer<luanatic::ph::Result>));
+
+            String luaCode = "local s = samples()\n"
+                             "assert(#s == 3 and s[1] == 0.5 and s[3] == 2.5)\n"
+                             "s[2] = 4 assert(s[2] == 4)\n"
+                             "assert(not pcall(function() return s[0] end))\n"
+                             "assert(not pcall(function() return s[4] end))\n"
+                             "assert(not pcall(function() return s.foo end))\n"
+                             "assert(not pcall(function() s[1] = 'x' end))\n"
+                             "assert(getmetatable(s) == 'Buffer')\n"
+                             "local idx = indices()\n"
+                             "assert(#idx == 3 and idx[1] == 3)\n"
+                             "assert(not pcall(function() idx[1] = 5 end))\n";
+            auto err = luanatic::execute(state, luaCode);
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            //writes go straight to the C++ memory
+            EXPECT(samples()[1] == 4.0f);
+            samples()[0] = 8.0f;
+            err = luanatic::execute(state, "assert(samples()[1] == 8)");
+            EXPECT(!err);
+
+            Float64 values[] = {1.0, 2.0};
+            luanatic::pushBuffer(state, values, 2);
+            EXPECT(luanatic::detail::toBuffer(state, -1) != nullptr);
+            EXPECT(luanatic::detail::toBuffer(state, -1)->m_elementType == luanatic::BufferElementType::Float64);
+            lua_setglobal(state, "values");
+            err = luanatic::execute(state, "values[2] = values[1] + values[2]");
+            EXPECT(!err);
+            EXPECT(values[1] == 3.0);
+
+            //rejected writes leave the element untouched
+            Int32 ivals[] = {7};
+            luanatic::pushBuffer(state, ivals, 1);
+            lua_setglobal(state, "ivals");
+            err = luanatic::execute(state, "ivals[1] = 2.5");
+            EXPECT(err && std::strstr(err.message().cString(), "Integer expected to write to buffer, got non integral number"));
+            lua_pop(state, 1);
+            err = luanatic::execute(state, "ivals[1] = 'x'");
+            EXPECT(err && std::strstr(err.message().cString(), "Integer expected to write to buffer, got string"));
+            lua_pop(state, 1);
+            err = luanatic::execute(state, "values[1] = 'x'");
+            EXPECT(err && std::strstr(err.message().cString(), "Number expected to write to buffer, got string"));
+            lua_pop(state, 1);
+            EXPECT(ivals[0] == 7);
+            EXPECT(values[0] == 1.0);
+
+            //the simd kernels, with lengths that are not a multiple of the vector width
+            DynamicArray<Float32> fa(19), fb(19), fc(19), fdst(19);
+            DynamicArray<Int32> ia(19), ib(19), idst(19);
+            for (Size i = 0; i < 19; ++i)
+            {
+                fa[i] = static_cast<Float32>(i);
+                fb[i] = 2.0f;
+                fc[i] = 1.0f;
+                ia[i] = static_cast<Int32>(i);
+                ib[i] = 10;
+            }
+            luanatic::pushBuffer(state, fa.ptr(), fa.count());
+            lua_setglobal(state, "fa");
+            luanatic::pushBuffer(state, static_cast<const Float32 *>(fb.ptr()), fb.count());
+            lua_setglobal(state, "fb");
+            luanatic::pushBuffer(state, fc.ptr(), fc.count());
+            lua_setglobal(state, "fc");
+            luanatic::pushBuffer(state, fdst.ptr(), fdst.count());
+            lua_setglobal(state, "fdst");
+            luanatic::pushBuffer(state, ia.ptr(), ia.count());
+            lua_setglobal(state, "ia");
+            luanatic::pushBuffer(state, ib.ptr(), ib.count());
+            lua_setglobal(state, "ib");
+            luanatic::pushBuffer(state, idst.ptr(), idst.count());
+            lua_setglobal(state, "idst");
+
+            luaCode = "local simd = luanatic.simd\n"
+                      "simd.add(fdst, fa, fb) for i = 1, 19 do assert(fdst[i] == i + 1) end\n"
+                      "simd.mul(fdst, fa, fb) for i = 1, 19 do assert(fdst[i] == (i - 1) * 2) end\n"
+                      "simd.fma(fdst, fa, fb, fc) for i = 1, 19 do assert(fdst[i] == (i - 1) * 2 + 1) end\n"
+                      "simd.scale(fdst, fa, 0.5) for i = 1, 19 do assert(fdst[i] == (i - 1) * 0.5) end\n"
+                      "simd.min(fdst, fa, fb) assert(fdst[1] == 0 and fdst[19] == 2)\n"
+                      "simd.max(fdst, fa, fb) assert(fdst[1] == 2 and fdst[19] == 18)\n"
+                      "simd.lerp(fdst, fa, fb, 0.5) for i = 1, 19 do assert(fdst[i] == (i - 1 + 2) * 0.5) end\n"
+                      "simd.clamp(fdst, fa, 3, 5) assert(fdst[1] == 3 and fdst[5] == 4 and fdst[19] == 5)\n"
+                      "assert(not pcall(simd.clamp, fdst, fa, 5, 3))\n"
+                      "assert(simd.sum(fa) == 171 and simd.dot(fa, fb) == 342)\n"
+                      "simd.add(idst, ia, ib) assert(idst[1] == 10 and idst[19] == 28)\n"
+                      "assert(simd.sum(ia) == 171 and simd.dot(ia, ib) == 1710)\n"
+                      "simd.fma(fa, fa, fb, fc) assert(fa[3] == 5)\n"
+                      "simd.gather(fdst, fa, 1, 1) assert(fdst[19] == 37)\n"
+                      "simd.scale(fdst, fdst, 0)\n"
+                      "assert(not pcall(simd.gather, fdst, fa, 2, 1))\n"
+                      "assert(not pcall(simd.add, fb, fa, fa))\n"
+                      "assert(not pcall(simd.add, idst, fa, fa))\n"
+                      "assert(not pcall(simd.sum, {}))\n";
+            err = luanatic::execute(state, luaCode);
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            //strided access, i.e. the x components of interleaved xy pairs
+            DynamicArray<Float32> xy = {1, 2, 3, 4, 5, 6};
+            DynamicArray<Float32> xs(3);
+            luanatic::pushBuffer(state, xy.ptr(), xy.count());
+            lua_setglobal(state, "xy");
+            luanatic::pushBuffer(state, xs.ptr(), xs.count());
+            lua_setglobal(state, "xs");
+            err = luanatic::execute(state, "luanatic.simd.gather(xs, xy, 1, 2) assert(xs[1] == 1 and xs[2] == 3 and xs[3] == 5)\n"
+                                    "luanatic.simd.scale(xs, xs, 10) luanatic.simd.scatter(xy, xs, 2, 2)\n"
+                                    "assert(not pcall(luanatic.simd.scatter, xy, xs, 3, 2))");
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+            EXPECT(xy[1] == 10.0f && xy[3] == 30.0f && xy[5] == 50.0f && xy[0] == 1.0f);
+
+            //strides whose end offset would wrap around, 8 * 2^61 is 2^64
+            DynamicArray<Float32> nine(9), nineDst(9);
+            luanatic::pushBuffer(state, nine.ptr(), nine.count());
+            lua_setglobal(state, "nine");
+            luanatic::pushBuffer(state, nineDst.ptr(), nineDst.count());
+            lua_setglobal(state, "nineDst");
+            err = luanatic::execute(state, "assert(not pcall(luanatic.simd.gather, nineDst, nine, 1, 2^61))\n"
+                                    "assert(not pcall(luanatic.simd.scatter, nine, nineDst, 1, 2^61))\n"
+                                    "assert(not pcall(luanatic.simd.gather, nineDst, nine, 2^62, 1))\n"
+                                    "nine, nineDst = nil");
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            //lerp between unsigned values that decrease, and extrapolation past the range of the type
+            UInt32 ua[] = {200, 0};
+            UInt32 ub[] = {100, 10};
+            UInt32 udst[2];
+            luanatic::pushBuffer(state, ua, 2);
+            lua_setglobal(state, "ua");
+            luanatic::pushBuffer(state, ub, 2);
+            lua_setglobal(state, "ub");
+            luanatic::pushBuffer(state, udst, 2);
+            lua_setglobal(state, "udst");
+            err = luanatic::execute(state, "luanatic.simd.lerp(udst, ua, ub, 0.5) assert(udst[1] == 150 and udst[2] == 5)\n"
+                                    "luanatic.simd.lerp(udst, ua, ub, 3) assert(udst[1] == 0 and udst[2] == 30)");
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            //the elements handled by the vector kernels and the scalar tail agree
+            DynamicArray<Float32> la(11), lb(11), ldst(11);
+            for (Size i = 0; i < la.count(); ++i)
+            {
+                la[i] = 0.1f;
+                lb[i] = 0.7f;
+            }
+            luanatic::pushBuffer(state, la.ptr(), la.count());
+            lua_setglobal(state, "la");
+            luanatic::pushBuffer(state, lb.ptr(), lb.count());
+            lua_setglobal(state, "lb");
+            luanatic::pushBuffer(state, ldst.ptr(), ldst.count());
+            lua_setglobal(state, "ldst");
+            err = luanatic::execute(state, "luanatic.simd.lerp(ldst, la, lb, 1 / 3)\n"
+                                    "for i = 2, #ldst do assert(ldst[i] == ldst[1]) end\n"
+                                    "la, lb, ldst = nil");
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            //integral arithmetic wraps around at the limits like lua integers do
+            Int32 ilimits[] = {std::numeric_limits<Int32>::max(), std::numeric_limits<Int32>::min()};
+            Int32 iones[] = {1, -1};
+            Int64 llimits[] = {std::numeric_limits<Int64>::max(), 1};
+            UInt16 slimits[] = {65535, 65535};
+            luanatic::pushBuffer(state, ilimits, 2);
+            lua_setglobal(state, "ilimits");
+            luanatic::pushBuffer(state, iones, 2);
+            lua_setglobal(state, "iones");
+            luanatic::pushBuffer(state, llimits, 2);
+            lua_setglobal(state, "llimits");
+            luanatic::pushBuffer(state, slimits, 2);
+            lua_setglobal(state, "slimits");
+            err = luanatic::execute(state, "local simd = luanatic.simd\n"
+                                    "simd.add(ilimits, ilimits, iones) assert(ilimits[1] == -2147483648 and ilimits[2] == 2147483647)\n"
+                                    "assert(simd.sum(llimits) == math.mininteger)\n"
+                                    "assert(simd.dot(llimits, llimits) == 2)\n"
+                                    "simd.mul(slimits, slimits, slimits) assert(slimits[1] == 1)\n"
+                                    "ilimits, iones, llimits, slimits = nil");
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            err = luanatic::execute(state, "fa, fb, fc, fdst, ia, ib, idst, xy, xs, ua, ub, udst = nil");
+            EXPECT(!err);
+        }
+        EXPECT(lua_gettop(state) == 0);
+        lua_close(state);
+    },
     SUITE("Overload Prep Tests")
     {
         DynamicArray<TypeID> signature;
@@ -939,6 +1752,14 @@ const Suite spec[] =
             globals.registerClass(bw);
             globals.registerFunction("printOverload", LUANATIC_FUNCTION(&printA));
             globals.registerFunction("printOverload", LUANATIC_FUNCTION(&printB));
+            globals.registerFunction("signOverload", LUANATIC_FUNCTION_OVERLOAD(const char * (*)(UInt32), &signOverload));
+            globals.registerFunction("signOverload", LUANATIC_FUNCTION_OVERLOAD(const char * (*)(const String &), &signOverload));
+            //scores that look at the string contents are never served from the overload cache
+            luanatic::LuanaticFunction colorFunction = LUANATIC_FUNCTION_OVERLOAD(const char * (*)(ColorName), &namedOverload);
+            EXPECT(!colorFunction.bShapeOnlyScore);
+            EXPECT(luanatic::LuanaticFunction(LUANATIC_FUNCTION_OVERLOAD(const char * (*)(const String &), &signOverload)).bShapeOnlyScore);
+            globals.registerFunction("namedOverload", colorFunction);
+            globals.registerFunction("namedOverload", LUANATIC_FUNCTION_OVERLOAD(const char * (*)(ShapeName), &namedOverload));
 
             String luaCode = "local a = overloadedFunction(1, 2)\n"
                              "assert(a == 3)\n"
@@ -952,6 +1773,19 @@ const Suite spec[] =
                              "assert(e.b == 1.0)\n"
                              "assert(printOverload(d) == 0.25)\n"
                              "assert(printOverload(e) == 1.0)\n"
+                             //alternate between argument types to make sure the overload cache picks the right one
+                             "for i=1, 3 do\n"
+                             "  assert(overloadedFunction(1, 2) == 3)\n"
+                             "  assert(overloadedFunction(\"hello\") == \"hello\")\n"
+                             "  assert(printOverload(d) == 0.25)\n"
+                             "  assert(printOverload(e) == 1.0)\n"
+                             "  assert(signOverload(5) == \"unsigned\")\n"
+                             "  assert(signOverload(-5) == \"string\")\n"
+                             "  assert(signOverload(\"-5\") == \"string\")\n"
+                             "  assert(namedOverload(\"red\") == \"color\")\n"
+                             "  assert(namedOverload(\"circle\") == \"shape\")\n"
+                             "  assert(not pcall(namedOverload, \"blue\"))\n"
+                             "end\n"
                              ;
 
             auto err = luanatic::execute(state, luaCode);
@@ -959,6 +1793,17 @@ const Suite spec[] =
                 printf("%s\n", err.message().cString());
 
             EXPECT(!err);
+
+            globals.registerFunction("ambiguousOverload", LUANATIC_FUNCTION_OVERLOAD(Int32(*)(Int32), &ambiguousOverload));
+            globals.registerFunction("ambiguousOverload", LUANATIC_FUNCTION_OVERLOAD(Float32(*)(Float32), &ambiguousOverload));
+            err = luanatic::execute(state, "ambiguousOverload(1)");
+            EXPECT(err);
+            EXPECT(std::strstr(err.message().cString(), "Ambiguous call"));
+            lua_pop(state, 1);
+            err = luanatic::execute(state, "ambiguousOverload(1, 2)");
+            EXPECT(err);
+            EXPECT(std::strstr(err.message().cString(), "Could not find candidate"));
+            lua_pop(state, 1);
         }
 
         EXPECT(lua_gettop(state) == 0);
@@ -1133,6 +1978,119 @@ const Suite spec[] =
         }
         EXPECT(lua_gettop(state) == 0);
         lua_close(state);
+    },
+    SUITE("Lua Allocator Tests")
+    {
+        CountingAllocator alloc;
+        lua_State * state = luanatic::createLuaState(alloc);
+        EXPECT(state != nullptr);
+        {
+            luanatic::openStandardLibraries(state);
+            luanatic::initialize(state, alloc);
+            luanatic::LuaValue globals = luanatic::globalsTable(state);
+
+            luanatic::ClassWrapper<PooledClass> pw("PooledClass");
+            pw.
+            setStorageMode(luanatic::StorageMode::Pooled).
+            addConstructor<Int32>().
+            addAttribute("val", LUANATIC_ATTRIBUTE(&PooledClass::val));
+            globals.registerClass(pw);
+
+            auto stats = luanatic::luaAllocatorStatistics(state);
+            EXPECT((bool)stats);
+            EXPECT((*stats).blockCount > 0);
+            EXPECT((*stats).byteCount > 0);
+
+            //small and big strings, growing tables and userdata
+            String luaCode = "local t = {}\n"
+                             "for i = 1, 1000 do t[i] = PooledClass(i) t['k' .. i] = string.rep('x', i) end\n"
+                             "for i = 1, 1000 do assert(t[i].val == i and #t['k' .. i] == i) end\n"
+                             "t = nil collectgarbage()";
+            auto err = luanatic::execute(state, luaCode);
+            if (err)
+                printf("%s\n", err.message().cString());
+            EXPECT(!err);
+
+            auto after = luanatic::luaAllocatorStatistics(state);
+            EXPECT((*after).allocationCount > (*stats).allocationCount + 3000);
+            EXPECT((*after).pooledAllocationCount > (*stats).pooledAllocationCount);
+            EXPECT((*after).pooledAllocationCount < (*after).allocationCount);
+            EXPECT((*after).blockCount < (*after).allocationCount);
+
+            //states with the default allocator have no statistics
+            lua_State * other = luanatic::createLuaState();
+            EXPECT(!luanatic::luaAllocatorStatistics(other));
+            lua_close(other);
+
+            //threads created before initialize copy whatever was in the extra space of the main thread,
+            //both for states luanatic created and for foreign ones
+            Size blockCount = 0;
+            lua_State * states[2] = {lua_newstate(garbageLuaAlloc, &blockCount),
+                                     luanatic::createLuaState(garbageLuaAlloc, &blockCount)};
+            for (lua_State * s : states)
+            {
+                EXPECT(s != nullptr);
+                lua_State * thread = lua_newthread(s);
+                luanatic::initialize(s);
+                luanatic::detail::LuanaticState * ls = luanatic::detail::luanaticState(s);
+                EXPECT(ls != nullptr);
+                EXPECT(luanatic::detail::luanaticState(thread) == ls);
+                EXPECT(luanatic::detail::luanaticState(lua_newthread(s)) == ls);
+                lua_pop(s, 2);
+                lua_close(s);
+            }
+            //including the forwarding allocator
+            EXPECT(blockCount == 0);
+
+            //lua_newstate failing at any point must release everything exactly once
+            for (Size failAfter = 0; ; ++failAfter)
+            {
+                FailingLuaAlloc fa = {failAfter, 0, 0};
+                lua_State * s = luanatic::createLuaState(failingLuaAlloc, &fa);
+                if (s)
+                {
+                    fa.failAfter = std::numeric_limits<Size>::max();
+                    lua_close(s);
+                    EXPECT(fa.blockCount == 0);
+                    break;
+                }
+                EXPECT(fa.blockCount == 0);
+            }
+        }
+        {
+            //shrinking a block into a size class without free slots must not fail, even if no
+            //new slab can be allocated
+            using LuaAllocator = luanatic::detail::LuaAllocator;
+            CountingAllocator failing;
+            {
+                LuaAllocator la(failing);
+                void * pooled = LuaAllocator::allocFunction(&la, nullptr, 0, 200);
+                void * big = LuaAllocator::allocFunction(&la, nullptr, 0, 1000);
+                EXPECT(pooled && big);
+                std::memset(pooled, 1, 200);
+                std::memset(big, 2, 1000);
+                failing.bFailAllocations = true;
+                EXPECT(LuaAllocator::allocFunction(&la, pooled, 200, 20) == pooled);
+                EXPECT(LuaAllocator::allocFunction(&la, big, 1000, 100) == big);
+                EXPECT(LuaAllocator::allocFunction(&la, nullptr, 0, 50) == nullptr);
+                EXPECT(static_cast<char *>(pooled)[19] == 1 && static_cast<char *>(big)[99] == 2);
+
+                //both are slots of their new size class from now on
+                LuaAllocator::allocFunction(&la, pooled, 20, 0);
+                LuaAllocator::allocFunction(&la, big, 100, 0);
+                EXPECT(LuaAllocator::allocFunction(&la, nullptr, 0, 20) == pooled);
+                EXPECT(LuaAllocator::allocFunction(&la, nullptr, 0, 100) == big);
+                EXPECT(la.m_stats.byteCount == 120);
+                LuaAllocator::allocFunction(&la, pooled, 20, 0);
+                LuaAllocator::allocFunction(&la, big, 100, 0);
+                failing.bFailAllocations = false;
+            }
+            EXPECT(failing.blockCount == 0);
+        }
+        EXPECT(lua_gettop(state) == 0);
+        lua_close(state);
+        //the pools and the lua allocator itself are released by lua_close
+        EXPECT(alloc.blockCount == 0);
     }
 };
 